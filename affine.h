@@ -0,0 +1,741 @@
+#ifndef __AFFINE_H__
+#define __AFFINE_H__
+/* *************DOC***************
+ * Affine geometry: points, vectors, segments, and lines.
+ *
+ * Include SDL.h first: AffPoint is an SDL_FPoint so polygons go straight
+ * to SDL_RenderDrawLinesF.
+ * *******************************/
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef SDL_FPoint AffPoint;                                    // point
+typedef AffPoint AffVec;                                        // vector
+
+AffVec aff_vec_from_points(AffPoint A, AffPoint B)
+{ // Return vector AB (the vector that goes from A to B)
+    return (AffPoint){B.x-A.x, B.y-A.y};
+}
+typedef struct
+{
+    AffPoint A, B;
+} AffSeg;
+// Alias affine segments as oriented sides
+typedef AffSeg AffOrS;                                          // oriented side
+float aff_sarea_poly(AffPoint *poly, int n)
+{ // Signed area of polygon with n points
+    /* *************DOC***************
+     * Uses definition of signed area of a polygon as the sum of
+     * the signed areas of each oriented side.
+     *
+     * The order of the points (clockwise or counter clockwise)
+     * affects the sign of the signed area.
+     *
+     * clockwise            : signed area is positive
+     * counter-clockwise    : signed area is negative
+     * *******************************/
+    float s = 0;                                                // Total signed area
+    AffVec u,v;
+    for(int i=0; i<(n-1); i++)
+    {
+        u = poly[i]; v = poly[i+1];
+        s += 0.5*(u.x*v.y - v.x*u.y);
+    }
+    return s;
+}
+
+typedef struct
+{
+    float a,b,c;
+} AffLine;                                                      // line (infinite extent)
+AffLine aff_join_of_points(AffPoint A, AffPoint B)
+{ // Return join of points A and B
+    float alpha = B.x-A.x; float beta = B.y-A.y;
+    float c = -1*beta*A.x + alpha*A.y;
+    AffLine l = {-1*beta, alpha, c};
+    return l;
+}
+AffPoint aff_meet_of_lines(AffLine l1, AffLine l2)
+{ // Return meet of lines l1 and l2 <--? What happens if lines don't intersect?
+    /* *************DOC***************
+     * TODO:
+     * - Return meet by passing meet as a pointer arg
+     * - Use return value for a success/fail (meet/no-meet)
+     * *******************************/
+    float a1 = l1.a; float b1 = l1.b; float c1 = l1.c;
+    float a2 = l2.a; float b2 = l2.b; float c2 = l2.c;
+    float det = 1/(a1*b2 - a2*b1);                              // What happens when 1/0?
+    float x = det*(b2*c1 - b1*c2);
+    float y = det*(a1*c2 - a2*c1);
+    AffPoint M = {x,y};
+    return M;
+}
+
+
+int aff_scanline_meets(AffPoint *poly, AffLine *sides, int poly_cnt, float y, AffPoint *meets)
+{
+    /* *************DOC***************
+     * Intersect scanline y with each side of the polygon.
+     *
+     * poly     : poly_cnt points, last point repeats the first
+     * sides    : sides[i] = aff_join_of_points(poly[i], poly[i+1])
+     * meets    : room for poly_cnt-1 meets
+     *
+     * Return the number of meets stored in meets.
+     * Fill the span from meets[i] to meets[i+1] at y=meets[i].y
+     * *******************************/
+    AffLine scanline = {0, 1, y};                               // Line : y = constant
+    int meet_cnt = 0;                                           // Count intersections
+    for( int i=0; i<(poly_cnt-1); i++ )
+    {
+        AffPoint meet = aff_meet_of_lines(scanline, sides[i]);
+        // DEBUG: does this fix bugs where fill line is dropped?
+        // Nope, makes it worse!
+        /* meet.x = (int)meet.x; meet.y = (int)meet.y; */
+
+        // Vector u : from a vertex on this side to the meet
+        AffVec u = aff_vec_from_points(poly[i], meet);
+        // Vector v : the two vertices that defined this side
+        AffVec v = aff_vec_from_points(poly[i], poly[i+1]);
+        bool float_error = true;
+        float lambda;                                           // scaling factor btwn u and v
+        { // Lambda is just a ratio, but floating point error makes this tricky.
+            // Get this wrong and every once in a while a line is dropped or doubled.
+            /* if(  u.y != 0  ){ lambda = u.y / v.y; } */
+            /* else            { lambda = u.x / v.x; } */
+            float epsilon = 0.01;                               // Floating point error
+            if(  u.x != 0  )     // Use vec.x if non-zero
+            {
+                lambda = u.x / v.x;
+                if(  (v.x > epsilon) || (v.x < -1*epsilon) ) {float_error = false;}
+            }
+            else     // Use vec.y if vec.x is 0
+            {
+                lambda = u.y / v.y;
+                if(  (v.y > epsilon) || (v.y < -1*epsilon) ) {float_error = false;}
+            }
+        }
+        // TODO:
+        // I don't want both lambda=0 and lambda=1, pick one.
+        // The reason is I get two fill lines at the same y-value.
+        // If the color has alpha, then the two lines overlap and it
+        // doesn't look good.
+        // TODO:
+        // The calculation of the meet is *slightly* off. Why?
+        // This causes the occasional fill line to get dropped.
+        if(  float_error == false  )
+        {
+            if(  (lambda>0) && (lambda<=1)  )                   // The meet is on the poly seg
+            {
+                meets[meet_cnt] = meet;                         // Store this meet
+                meet_cnt++;                                     // Track number of meets
+            }
+        }
+    }
+    return meet_cnt;
+}
+
+/* *************Compound paths***************
+ * A path is one or more closed contours filled together, so a contour
+ * inside another can cut a hole in it.
+ *
+ * pts holds every contour back to back. Each contour repeats its first
+ * point at the end (like poly), so SDL_RenderDrawLinesF can outline it:
+ *
+ *      contour c : pts[start(c)] ... pts[ends[c]-1]
+ *      start(c)  : 0 for c=0, else ends[c-1]
+ *
+ * Fill rule: walk a scanline left to right, add +1 crossing a side that
+ * goes down, -1 crossing a side that goes up.
+ *
+ *      AFF_FILL_NONZERO : inside where the sum is not zero
+ *      AFF_FILL_EVENODD : inside where the sum is odd
+ *
+ * With nonzero a hole must wind the other way (clockwise outline,
+ * counter-clockwise hole). With even-odd any nested contour is a hole.
+ * *******************************/
+typedef enum { AFF_FILL_NONZERO, AFF_FILL_EVENODD } AffFillRule;
+
+typedef struct
+{
+    AffPoint *pts; int pt_cnt; int pt_cap;                      // All contours' points
+    int *ends; int contour_cnt; int contour_cap;                // One past each contour
+} AffPath;
+
+void aff_path_clear(AffPath *path)
+{ // Empty the path, keep the memory
+    path->pt_cnt = 0; path->contour_cnt = 0;
+}
+
+void aff_path_free(AffPath *path)
+{
+    free(path->pts); free(path->ends);
+    *path = (AffPath){0};
+}
+
+void aff_path_add_contour(AffPath *path, const AffPoint *pts, int n)
+{ // Append a contour of n points. Closes it if pts[n-1] != pts[0].
+    if(  n < 2  ) return;
+    bool closed = (pts[0].x == pts[n-1].x) && (pts[0].y == pts[n-1].y);
+    int need = path->pt_cnt + n + (closed ? 0 : 1);
+    if(  need > path->pt_cap  )
+    {
+        path->pt_cap = 2*need;
+        path->pts = realloc(path->pts, sizeof(AffPoint)*path->pt_cap);
+    }
+    if(  path->contour_cnt == path->contour_cap  )
+    {
+        path->contour_cap = path->contour_cap ? 2*path->contour_cap : 8;
+        path->ends = realloc(path->ends, sizeof(int)*path->contour_cap);
+    }
+    memcpy(path->pts + path->pt_cnt, pts, sizeof(AffPoint)*n);
+    path->pt_cnt += n;
+    if(  !closed  ) path->pts[path->pt_cnt++] = pts[0];
+    path->ends[path->contour_cnt++] = path->pt_cnt;
+}
+
+int aff_path_start(const AffPath *path, int c)
+{ // Index of the first point of contour c
+    return (c == 0) ? 0 : path->ends[c-1];
+}
+
+typedef struct
+{
+    float y, x0, x1;                                            // Fill x0 to x1 at y
+} AffSpan;
+
+typedef struct
+{
+    AffSpan *s; int cnt; int cap;
+} AffSpanList;
+
+typedef struct
+{
+    float y0, y1;                                               // Top, bottom (y0 < y1)
+    float x0, dxdy;                                             // x at y0, slope
+    int dir;                                                    // +1 down, -1 up
+} AffEdge;
+
+int aff_cmp_edge_y0(const void *a, const void *b)
+{ // qsort edges by top
+    float ya = ((const AffEdge *)a)->y0; float yb = ((const AffEdge *)b)->y0;
+    return (ya>yb) - (ya<yb);
+}
+
+int aff_path_spans(const AffPath *path, AffFillRule rule, int row0, int row1, AffSpanList *out)
+{
+    /* *************DOC***************
+     * Fill the path in one sweep over all contours' sides.
+     *
+     * Rows row0 to row1-1 are sampled at their centers (y = row + 0.5).
+     * Spans are appended to out, top row first, left to right:
+     *      span.y = row, fill span.x0 to span.x1
+     *
+     * Each side counts on rows in [top, bottom): a vertex shared by two
+     * sides is hit once, so no doubled or dropped fill lines.
+     *
+     * Return the number of spans appended.
+     * *******************************/
+    int start_cnt = out->cnt;
+    // Edge table : every non-horizontal side of every contour, sorted by top
+    AffEdge *edges = malloc(sizeof(AffEdge)*(path->pt_cnt+1));
+    int edge_cnt = 0;
+    for( int c=0; c<path->contour_cnt; c++ )
+    {
+        for( int i=aff_path_start(path, c); i<path->ends[c]-1; i++ )
+        {
+            AffPoint A = path->pts[i]; AffPoint B = path->pts[i+1];
+            if(  A.y == B.y  ) continue;                        // Horizontal : no crossing
+            AffEdge e;
+            e.dir = (A.y < B.y) ? 1 : -1;
+            if(  e.dir < 0  ) { AffPoint t = A; A = B; B = t; }
+            e.y0 = A.y; e.y1 = B.y; e.x0 = A.x;
+            e.dxdy = (B.x - A.x)/(B.y - A.y);
+            edges[edge_cnt++] = e;
+        }
+    }
+    qsort(edges, edge_cnt, sizeof(AffEdge), aff_cmp_edge_y0);
+
+    // Sweep : active edges cross the current scanline
+    int *active = malloc(sizeof(int)*(edge_cnt+1)); int active_cnt = 0;
+    struct { float x; int dir; } *cross = malloc(sizeof(*cross)*(edge_cnt+1));
+    int next = 0;                                               // Next edge to activate
+    for( int row=row0; row<row1; row++ )
+    {
+        float y = row + 0.5;                                    // Pixel center
+        while(  (next < edge_cnt) && (edges[next].y0 <= y)  ) active[active_cnt++] = next++;
+        if(  (active_cnt == 0) && (next == edge_cnt)  ) break;  // Nothing left below
+        int cross_cnt = 0;
+        for( int k=0; k<active_cnt; )
+        {
+            AffEdge *e = &edges[active[k]];
+            if(  e->y1 <= y  ) { active[k] = active[--active_cnt]; continue; }   // Done
+            float x = e->x0 + (y - e->y0)*e->dxdy;
+            int j = cross_cnt++;                                // Insertion sort by x
+            while(  (j > 0) && (cross[j-1].x > x)  ) { cross[j] = cross[j-1]; j--; }
+            cross[j].x = x; cross[j].dir = e->dir;
+            k++;
+        }
+        int winding = 0;
+        for( int j=0; j<cross_cnt-1; j++ )
+        {
+            winding += cross[j].dir;
+            bool inside = (rule == AFF_FILL_NONZERO) ? (winding != 0) : (winding & 1);
+            if(  !inside || (cross[j+1].x <= cross[j].x)  ) continue;
+            if(  (out->cnt > start_cnt) && (out->s[out->cnt-1].y == row)
+              && (out->s[out->cnt-1].x1 == cross[j].x)  )
+            { // Touching the last span : extend it
+                out->s[out->cnt-1].x1 = cross[j+1].x; continue;
+            }
+            if(  out->cnt == out->cap  )
+            {
+                out->cap = out->cap ? 2*out->cap : 1024;
+                out->s = realloc(out->s, sizeof(AffSpan)*out->cap);
+            }
+            out->s[out->cnt++] = (AffSpan){row, cross[j].x, cross[j+1].x};
+        }
+    }
+    free(cross); free(active); free(edges);
+    return out->cnt - start_cnt;
+}
+
+void aff_path_append(AffPath *dst, const AffPath *src)
+{ // Append every contour of src to dst
+    for( int c=0; c<src->contour_cnt; c++ )
+    {
+        int start = aff_path_start(src, c);
+        aff_path_add_contour(dst, src->pts+start, src->ends[c]-start);
+    }
+}
+
+/* *************Bezier curves***************
+ * A curve path is a list of drawing ops, like a pen:
+ *
+ *      AFF_MOVE    : start a new contour at p[0]
+ *      AFF_LINE    : line to p[0]
+ *      AFF_QUAD    : quadratic Bezier, control p[0], to p[1]
+ *      AFF_CUBIC   : cubic Bezier, controls p[0] p[1], to p[2]
+ *
+ * The fill only knows straight sides, so curves are flattened: split in
+ * half (de Casteljau) until the control points are within tol of the
+ * chord, then keep the chord. Flat parts of a curve get few sides, tight
+ * bends get many.
+ *
+ * tol is in model units. For an on-screen tolerance of px pixels at
+ * scale view_s, tol = px/view_s.
+ * *******************************/
+typedef enum { AFF_MOVE, AFF_LINE, AFF_QUAD, AFF_CUBIC } AffCurveOp;
+
+typedef struct
+{
+    AffCurveOp op;
+    AffPoint p[3];                                              // Controls, then end point
+} AffCurveSeg;
+
+typedef struct
+{
+    AffCurveSeg *segs; int seg_cnt; int seg_cap;
+} AffCurvePath;
+
+void aff_curve_push(AffCurvePath *cp, AffCurveSeg seg)
+{
+    if(  cp->seg_cnt == cp->seg_cap  )
+    {
+        cp->seg_cap = cp->seg_cap ? 2*cp->seg_cap : 16;
+        cp->segs = realloc(cp->segs, sizeof(AffCurveSeg)*cp->seg_cap);
+    }
+    cp->segs[cp->seg_cnt++] = seg;
+}
+void aff_curve_move_to(AffCurvePath *cp, AffPoint P)
+{ aff_curve_push(cp, (AffCurveSeg){AFF_MOVE, {P}}); }
+void aff_curve_line_to(AffCurvePath *cp, AffPoint P)
+{ aff_curve_push(cp, (AffCurveSeg){AFF_LINE, {P}}); }
+void aff_curve_quad_to(AffCurvePath *cp, AffPoint C, AffPoint P)
+{ aff_curve_push(cp, (AffCurveSeg){AFF_QUAD, {C, P}}); }
+void aff_curve_cubic_to(AffCurvePath *cp, AffPoint C1, AffPoint C2, AffPoint P)
+{ aff_curve_push(cp, (AffCurveSeg){AFF_CUBIC, {C1, C2, P}}); }
+
+void aff_curve_free(AffCurvePath *cp)
+{
+    free(cp->segs);
+    *cp = (AffCurvePath){0};
+}
+
+typedef struct
+{
+    AffPoint *pts; int cnt; int cap;
+} AffPointList;
+
+void aff_point_push(AffPointList *l, AffPoint P)
+{
+    if(  l->cnt == l->cap  )
+    {
+        l->cap = l->cap ? 2*l->cap : 64;
+        l->pts = realloc(l->pts, sizeof(AffPoint)*l->cap);
+    }
+    l->pts[l->cnt++] = P;
+}
+
+AffPoint aff_mid(AffPoint A, AffPoint B)
+{ // Midpoint of A and B
+    return (AffPoint){0.5f*(A.x+B.x), 0.5f*(A.y+B.y)};
+}
+
+float aff_dist_to_chord(AffPoint P, AffPoint A, AffPoint B)
+{ // Distance from P to the line through A and B (or to A if A == B)
+    float dx = B.x-A.x; float dy = B.y-A.y;
+    float len2 = dx*dx + dy*dy;
+    float px = P.x-A.x; float py = P.y-A.y;
+    if(  len2 == 0  ) return sqrtf(px*px + py*py);
+    return fabsf(px*dy - py*dx)/sqrtf(len2);
+}
+
+#define AFF_FLATTEN_DEPTH 16                                    // At most 2^16 sides per curve
+
+void aff_flatten_quad(AffPointList *l, AffPoint A, AffPoint C, AffPoint B, float tol, int depth)
+{ // Append points after A up to and including B
+    if(  (depth >= AFF_FLATTEN_DEPTH) || (aff_dist_to_chord(C, A, B) <= tol)  )
+    {
+        aff_point_push(l, B); return;
+    }
+    AffPoint AC = aff_mid(A, C); AffPoint CB = aff_mid(C, B);
+    AffPoint M = aff_mid(AC, CB);                               // Curve at t=0.5
+    aff_flatten_quad(l, A, AC, M, tol, depth+1);
+    aff_flatten_quad(l, M, CB, B, tol, depth+1);
+}
+
+void aff_flatten_cubic(AffPointList *l, AffPoint A, AffPoint C1, AffPoint C2, AffPoint B, float tol, int depth)
+{ // Append points after A up to and including B
+    if(  (depth >= AFF_FLATTEN_DEPTH) ||
+         ((aff_dist_to_chord(C1, A, B) <= tol) && (aff_dist_to_chord(C2, A, B) <= tol))  )
+    {
+        aff_point_push(l, B); return;
+    }
+    AffPoint P1 = aff_mid(A, C1); AffPoint P2 = aff_mid(C1, C2); AffPoint P3 = aff_mid(C2, B);
+    AffPoint Q1 = aff_mid(P1, P2); AffPoint Q2 = aff_mid(P2, P3);
+    AffPoint M = aff_mid(Q1, Q2);                               // Curve at t=0.5
+    aff_flatten_cubic(l, A, P1, Q1, M, tol, depth+1);
+    aff_flatten_cubic(l, M, Q2, P3, B, tol, depth+1);
+}
+
+void aff_curve_flatten(const AffCurvePath *cp, float tol, AffPath *out)
+{
+    /* *************DOC***************
+     * Flatten curve path cp into closed contours, appended to out.
+     * Control points are within tol (model units) of the sides.
+     * *******************************/
+    AffPointList l = {0};
+    AffPoint cur = {0, 0};                                      // Pen position
+    for( int i=0; i<=cp->seg_cnt; i++ )
+    {
+        if(  (i == cp->seg_cnt) || (cp->segs[i].op == AFF_MOVE)  )
+        { // Close the contour so far
+            if(  l.cnt > 1  ) aff_path_add_contour(out, l.pts, l.cnt);
+            l.cnt = 0;
+            if(  i == cp->seg_cnt  ) break;
+        }
+        const AffCurveSeg *g = &cp->segs[i];
+        switch(  g->op  )
+        {
+            case AFF_MOVE:  cur = g->p[0]; aff_point_push(&l, cur); break;
+            case AFF_LINE:  cur = g->p[0]; aff_point_push(&l, cur); break;
+            case AFF_QUAD:  aff_flatten_quad(&l, cur, g->p[0], g->p[1], tol, 0); cur = g->p[1]; break;
+            case AFF_CUBIC: aff_flatten_cubic(&l, cur, g->p[0], g->p[1], g->p[2], tol, 0); cur = g->p[2]; break;
+        }
+    }
+    free(l.pts);
+}
+
+/* *************Flattening cache***************
+ * Flattening depends on zoom: tol = px/view_s. Re-flattening every frame
+ * is wasted work while the zoom holds still, and even while it changes a
+ * little. So flatten once per zoom bucket:
+ *
+ *      bucket = floor(4*log2(view_s))          (4 buckets per doubling)
+ *
+ * and flatten for the largest view_s in the bucket. The on-screen error
+ * stays within px for every zoom in the bucket, and the curve is only
+ * re-flattened when the zoom crosses into another bucket.
+ * *******************************/
+#define AFF_ZOOM_BUCKETS_PER_OCTAVE 4
+
+typedef struct
+{
+    bool valid;                                                 // False : flatten on next get
+    int bucket;                                                 // Zoom bucket of flat
+    AffPath flat;                                               // Flattened, model units
+} AffFlatCache;
+
+int aff_zoom_bucket(float view_s)
+{ // Zoom bucket holding scale view_s
+    return (int)floorf(AFF_ZOOM_BUCKETS_PER_OCTAVE*log2f(view_s));
+}
+
+const AffPath *aff_flat_cache_get(AffFlatCache *fc, const AffCurvePath *cp, float view_s, float px)
+{ // Flattened cp for this zoom, px : on-screen tolerance in pixels
+    int bucket = aff_zoom_bucket(view_s);
+    if(  !fc->valid || (bucket != fc->bucket)  )
+    {
+        float s_max = exp2f((float)(bucket+1)/AFF_ZOOM_BUCKETS_PER_OCTAVE);
+        aff_path_clear(&fc->flat);
+        aff_curve_flatten(cp, px/s_max, &fc->flat);
+        fc->bucket = bucket; fc->valid = true;
+    }
+    return &fc->flat;
+}
+
+/* *************Viewport clipping***************
+ * Zoomed in, most of the art is off screen. Clip each contour to the
+ * viewport first (Sutherland-Hodgman: clip against one window edge at a
+ * time), then fill and outline the clipped path. Work is bounded by what
+ * is visible, not by view_s.
+ *
+ * Parts of a contour outside the viewport become sides along its edges.
+ * Winding inside the viewport is unchanged, so both fill rules still
+ * work. Clip to a rect a little larger than the window so the new sides
+ * are never drawn.
+ * *******************************/
+typedef enum { AFF_CLIP_LEFT, AFF_CLIP_RIGHT, AFF_CLIP_TOP, AFF_CLIP_BOTTOM } AffClipEdge;
+
+bool aff_clip_inside(AffPoint P, AffClipEdge e, float v)
+{ // True if P is on the kept side of window edge e at v
+    switch(  e  )
+    {
+        case AFF_CLIP_LEFT:   return P.x >= v;
+        case AFF_CLIP_RIGHT:  return P.x <= v;
+        case AFF_CLIP_TOP:    return P.y >= v;
+        case AFF_CLIP_BOTTOM: return P.y <= v;
+    }
+    return true;
+}
+
+AffPoint aff_clip_cross(AffPoint A, AffPoint B, AffClipEdge e, float v)
+{ // Where side AB crosses window edge e at v (A and B on opposite sides)
+    if(  (e == AFF_CLIP_LEFT) || (e == AFF_CLIP_RIGHT)  )
+    {
+        float t = (v - A.x)/(B.x - A.x);
+        return (AffPoint){v, A.y + t*(B.y - A.y)};
+    }
+    float t = (v - A.y)/(B.y - A.y);
+    return (AffPoint){A.x + t*(B.x - A.x), v};
+}
+
+void aff_clip_edge(const AffPointList *in, AffClipEdge e, float v, AffPointList *out)
+{ // Clip polygon in (not closed) against one window edge
+    out->cnt = 0;
+    for( int i=0; i<in->cnt; i++ )
+    {
+        AffPoint A = in->pts[i==0 ? in->cnt-1 : i-1];           // Side A to B
+        AffPoint B = in->pts[i];
+        bool a_in = aff_clip_inside(A, e, v); bool b_in = aff_clip_inside(B, e, v);
+        if(  a_in != b_in  ) aff_point_push(out, aff_clip_cross(A, B, e, v));
+        if(  b_in  ) aff_point_push(out, B);
+    }
+}
+
+void aff_path_clip(const AffPath *src, SDL_FRect r, AffPath *dst)
+{
+    /* *************DOC***************
+     * Clip every contour of src to rect r. Clear dst, then add the
+     * clipped contours. Contours entirely outside r are dropped.
+     * *******************************/
+    AffPointList a = {0}; AffPointList b = {0};                 // Scratch, only if a contour clips
+    aff_path_clear(dst);
+    for( int c=0; c<src->contour_cnt; c++ )
+    {
+        int start = aff_path_start(src, c);
+        int n = src->ends[c] - start - 1;                       // Skip the closing point
+        const AffPoint *p = src->pts + start;
+        bool all_in = true;                                     // Common case: nothing to clip
+        for( int i=0; i<n; i++ )
+        {
+            if(  (p[i].x < r.x) || (p[i].x > r.x+r.w) || (p[i].y < r.y) || (p[i].y > r.y+r.h)  )
+            {
+                all_in = false; break;
+            }
+        }
+        if(  all_in  ) { aff_path_add_contour(dst, p, n); continue; }
+        a.cnt = 0;
+        for( int i=0; i<n; i++ ) aff_point_push(&a, p[i]);
+        aff_clip_edge(&a, AFF_CLIP_LEFT,   r.x,     &b);
+        aff_clip_edge(&b, AFF_CLIP_RIGHT,  r.x+r.w, &a);
+        aff_clip_edge(&a, AFF_CLIP_TOP,    r.y,     &b);
+        aff_clip_edge(&b, AFF_CLIP_BOTTOM, r.y+r.h, &a);
+        if(  a.cnt >= 3  ) aff_path_add_contour(dst, a.pts, a.cnt);
+    }
+    free(a.pts); free(b.pts);
+}
+
+/* *************Level of detail***************
+ * Zoomed out, many vertices land in the same pixel. Simplify each
+ * contour ahead of time (Douglas-Peucker) at a few zoom levels and draw
+ * the level that fits the zoom:
+ *
+ *      level k : error <= px/2^k model units, good for view_s <= 2^k
+ *
+ * On screen, the simplified outline is then within px pixels of the
+ * original. The last level is the original path, for view_s beyond the
+ * finest simplified level.
+ * *******************************/
+#define AFF_LOD_LEVELS 10                                       // view_s up to 2^9 = 512
+
+typedef struct
+{
+    AffPath level[AFF_LOD_LEVELS+1];                            // Last : original
+} AffLod;
+
+void aff_dp_keep(const AffPoint *p, int i0, int i1, float eps, bool *keep)
+{ // Douglas-Peucker: mark points to keep between p[i0] and p[i1] (both kept)
+    if(  i1 - i0 < 2  ) return;
+    float far = -1; int k = i0;
+    for( int i=i0+1; i<i1; i++ )
+    {
+        float d = aff_dist_to_chord(p[i], p[i0], p[i1]);
+        if(  d > far  ) { far = d; k = i; }
+    }
+    if(  far <= eps  ) return;                                  // All close to chord: drop them
+    keep[k] = true;
+    aff_dp_keep(p, i0, k, eps, keep);
+    aff_dp_keep(p, k, i1, eps, keep);
+}
+
+void aff_path_simplify(const AffPath *src, float eps, AffPath *dst)
+{
+    /* *************DOC***************
+     * Douglas-Peucker each contour of src to within eps, append to dst.
+     * A closed contour is split at point 0 and the point farthest from it.
+     * Contours that simplify to fewer than 3 points are dropped.
+     * *******************************/
+    AffPointList l = {0};
+    bool *keep = NULL; int keep_cap = 0;
+    for( int c=0; c<src->contour_cnt; c++ )
+    {
+        int start = aff_path_start(src, c);
+        int n = src->ends[c] - start;                           // Includes closing point
+        const AffPoint *p = src->pts + start;
+        if(  n > keep_cap  ) { keep_cap = n; keep = realloc(keep, sizeof(bool)*keep_cap); }
+        for( int i=0; i<n; i++ ) keep[i] = false;
+        int far_i = 0; float far = -1;
+        for( int i=1; i<n-1; i++ )
+        {
+            float dx = p[i].x-p[0].x; float dy = p[i].y-p[0].y;
+            if(  dx*dx + dy*dy > far  ) { far = dx*dx + dy*dy; far_i = i; }
+        }
+        if(  far_i == 0  ) continue;                            // Degenerate contour
+        keep[0] = true; keep[far_i] = true;
+        aff_dp_keep(p, 0, far_i, eps, keep);
+        aff_dp_keep(p, far_i, n-1, eps, keep);
+        l.cnt = 0;
+        for( int i=0; i<n-1; i++ ) { if(  keep[i]  ) aff_point_push(&l, p[i]); }
+        if(  l.cnt >= 3  ) aff_path_add_contour(dst, l.pts, l.cnt);
+    }
+    free(keep); free(l.pts);
+}
+
+void aff_lod_build(AffLod *lod, const AffPath *src, float px)
+{ // Precompute all levels of src, px : on-screen error in pixels
+    for( int k=0; k<AFF_LOD_LEVELS; k++ )
+    {
+        aff_path_clear(&lod->level[k]);
+        aff_path_simplify(src, px/exp2f(k), &lod->level[k]);
+    }
+    aff_path_clear(&lod->level[AFF_LOD_LEVELS]);
+    aff_path_append(&lod->level[AFF_LOD_LEVELS], src);
+}
+
+const AffPath *aff_lod_pick(const AffLod *lod, float view_s)
+{ // Coarsest level that is fine enough at scale view_s
+    int k = (int)ceilf(log2f(view_s)); if(k<0) {k=0;}
+    if(  k > AFF_LOD_LEVELS  ) k = AFF_LOD_LEVELS;
+    return &lod->level[k];
+}
+
+void aff_lod_free(AffLod *lod)
+{
+    for( int k=0; k<=AFF_LOD_LEVELS; k++ ) aff_path_free(&lod->level[k]);
+}
+
+/* *************Batch primitives***************
+ * The primitives above take one point or line at a time. These take
+ * arrays, so the compiler can vectorize them, and bench-affine.c can
+ * measure scalar vs batch and float vs double.
+ *
+ * _n   : arrays of structs (AffPoint, AffLine), same layout as above
+ * _soa : struct of arrays, one array per coordinate: every load is a
+ *        full vector of x or of y, no shuffles
+ * _d   : accumulate in double
+ * *******************************/
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void aff_vec_from_points_n(const AffPoint *A, const AffPoint *B, AffVec *out, int n)
+{ // out[i] = vector A[i]B[i]
+    for( int i=0; i<n; i++ ) out[i] = (AffVec){B[i].x-A[i].x, B[i].y-A[i].y};
+}
+
+void aff_join_of_points_soa(const float *ax, const float *ay, const float *bx, const float *by,
+                            float *la, float *lb, float *lc, int n)
+{ // Line i (la[i], lb[i], lc[i]) is the join of points A[i] and B[i]
+    for( int i=0; i<n; i++ )
+    {
+        float alpha = bx[i]-ax[i]; float beta = by[i]-ay[i];
+        la[i] = -beta; lb[i] = alpha; lc[i] = -beta*ax[i] + alpha*ay[i];
+    }
+}
+
+void aff_meet_of_lines_soa(const float *a1, const float *b1, const float *c1,
+                           const float *a2, const float *b2, const float *c2,
+                           float *x, float *y, int n)
+{ // Point i (x[i], y[i]) is the meet of line 1 i and line 2 i (inf/nan if parallel)
+    for( int i=0; i<n; i++ )
+    {
+        float det = 1/(a1[i]*b2[i] - a2[i]*b1[i]);
+        x[i] = det*(b2[i]*c1[i] - b1[i]*c2[i]);
+        y[i] = det*(a1[i]*c2[i] - a2[i]*c1[i]);
+    }
+}
+
+double aff_sarea_poly_d(const AffPoint *poly, int n)
+{ // aff_sarea_poly, summed in double
+    double s = 0;
+    for( int i=0; i<(n-1); i++ )
+    {
+        s += (double)poly[i].x*poly[i+1].y - (double)poly[i+1].x*poly[i].y;
+    }
+    return 0.5*s;
+}
+
+float aff_sarea_poly_soa(const float *x, const float *y, int n)
+{ // aff_sarea_poly on coordinate arrays, 8 (AVX) or 4 (SSE2) sides at a time
+    int i = 0; float s = 0;
+#if defined(__AVX__)
+    __m256 acc = _mm256_setzero_ps();
+    for( ; i+8<n; i+=8 )
+    {
+        __m256 x0 = _mm256_loadu_ps(x+i); __m256 x1 = _mm256_loadu_ps(x+i+1);
+        __m256 y0 = _mm256_loadu_ps(y+i); __m256 y1 = _mm256_loadu_ps(y+i+1);
+        acc = _mm256_add_ps(acc, _mm256_sub_ps(_mm256_mul_ps(x0, y1), _mm256_mul_ps(x1, y0)));
+    }
+    float lanes[8]; _mm256_storeu_ps(lanes, acc);
+    for( int k=0; k<8; k++ ) s += lanes[k];
+#elif defined(__SSE2__)
+    __m128 acc = _mm_setzero_ps();
+    for( ; i+4<n; i+=4 )
+    {
+        __m128 x0 = _mm_loadu_ps(x+i); __m128 x1 = _mm_loadu_ps(x+i+1);
+        __m128 y0 = _mm_loadu_ps(y+i); __m128 y1 = _mm_loadu_ps(y+i+1);
+        acc = _mm_add_ps(acc, _mm_sub_ps(_mm_mul_ps(x0, y1), _mm_mul_ps(x1, y0)));
+    }
+    float lanes[4]; _mm_storeu_ps(lanes, acc);
+    for( int k=0; k<4; k++ ) s += lanes[k];
+#endif
+    for( ; i<(n-1); i++ ) s += x[i]*y[i+1] - x[i+1]*y[i];     // Scalar tail
+    return 0.5f*s;
+}
+
+#endif // __AFFINE_H__
@@ -0,0 +1,232 @@
+/* *************DOC***************
+ * Microbenchmarks of the affine primitives on the fill hot path.
+ *
+ * $ ./bench-affine.exe                     -- all benchmarks
+ * $ ./bench-affine.exe sarea               -- only names containing "sarea"
+ *
+ * Each benchmark runs on each input set:
+ *      degenerate  : every point the same, so every line is 0,0,0 and
+ *                    every meet divides by zero (inf/nan)
+ *      random      : uniform points in an 800x600 window
+ *      large       : star polygon, 2^16 points, coordinates up to 1e4
+ *
+ * A sample times enough calls to cover about BENCH_MIN_CALLS elements.
+ * Results are ns per element (point, line, or side): min, median, mean,
+ * stddev, p99 over BENCH_REPS samples after BENCH_WARMUP.
+ *
+ * The signed area benchmarks also print their error against a long
+ * double sum, to weigh float vs double accuracy against speed.
+ * *******************************/
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "affine.h"
+#include "bench.h"
+
+#define BENCH_REPS      100                                     // Samples per benchmark
+#define BENCH_WARMUP    10                                      // Untimed samples
+#define BENCH_MIN_CALLS 65536                                   // Elements per sample
+#define BENCH_MAX_N     (1<<16)                                 // Largest input set
+
+volatile float bench_sink;                                      // Keep results alive
+volatile double bench_area;                                     // Last signed area, unrounded
+
+typedef struct
+{
+    const char *name;
+    int n;                                                      // Elements
+    // AoS
+    AffPoint A[BENCH_MAX_N], B[BENCH_MAX_N];                    // Point pairs, A is also a polygon
+    AffLine L1[BENCH_MAX_N], L2[BENCH_MAX_N];                   // Line pairs
+    // SoA copies of the same data
+    float ax[BENCH_MAX_N], ay[BENCH_MAX_N], bx[BENCH_MAX_N], by[BENCH_MAX_N];
+    float a1[BENCH_MAX_N], b1[BENCH_MAX_N], c1[BENCH_MAX_N];
+    float a2[BENCH_MAX_N], b2[BENCH_MAX_N], c2[BENCH_MAX_N];
+    // Outputs
+    AffVec V[BENCH_MAX_N];
+    float o1[BENCH_MAX_N], o2[BENCH_MAX_N], o3[BENCH_MAX_N];
+} BenchInput;
+
+typedef void (*BenchFn)(BenchInput *in);
+
+/* *************Input sets*************** */
+float bench_rand(uint32_t *s, float max)
+{ // Uniform in [0, max), xorshift
+    *s ^= *s << 13; *s ^= *s >> 17; *s ^= *s << 5;
+    return (*s >> 8) * (max/16777216.0f);
+}
+
+void bench_input_finish(BenchInput *in)
+{ // Close the polygon, make lines from the points, fill SoA copies
+    in->A[in->n-1] = in->A[0];
+    for( int i=0; i<in->n; i++ )
+    {
+        in->L1[i] = aff_join_of_points(in->A[i], in->B[i]);
+        in->L2[i] = aff_join_of_points(in->B[i], in->A[(i+1) % in->n]);
+        in->ax[i] = in->A[i].x; in->ay[i] = in->A[i].y;
+        in->bx[i] = in->B[i].x; in->by[i] = in->B[i].y;
+        in->a1[i] = in->L1[i].a; in->b1[i] = in->L1[i].b; in->c1[i] = in->L1[i].c;
+        in->a2[i] = in->L2[i].a; in->b2[i] = in->L2[i].b; in->c2[i] = in->L2[i].c;
+    }
+}
+
+void bench_input_degenerate(BenchInput *in, int n)
+{
+    in->name = "degenerate"; in->n = n;
+    for( int i=0; i<n; i++ ) { in->A[i] = (AffPoint){100, 100}; in->B[i] = in->A[i]; }
+    bench_input_finish(in);
+}
+
+void bench_input_random(BenchInput *in, int n)
+{
+    in->name = "random"; in->n = n;
+    uint32_t s = 12345;
+    for( int i=0; i<n; i++ )
+    {
+        in->A[i] = (AffPoint){bench_rand(&s, 800), bench_rand(&s, 600)};
+        in->B[i] = (AffPoint){bench_rand(&s, 800), bench_rand(&s, 600)};
+    }
+    bench_input_finish(in);
+}
+
+void bench_input_large(BenchInput *in, int n)
+{
+    in->name = "large"; in->n = n;
+    uint32_t s = 6789;
+    for( int i=0; i<n; i++ )
+    {
+        float t = 2*M_PI*i/(n-1);
+        float r = (i%2) ? 1e4 : 5e3;                            // Star: points alternate in and out
+        in->A[i] = (AffPoint){r*cosf(t), r*sinf(t)};
+        in->B[i] = (AffPoint){bench_rand(&s, 1e4), bench_rand(&s, 1e4)};
+    }
+    bench_input_finish(in);
+}
+
+/* *************Benchmarks***************
+ * One call runs over all in->n elements.
+ * *******************************/
+void vec_from_points(BenchInput *in)
+{
+    for( int i=0; i<in->n; i++ ) in->V[i] = aff_vec_from_points(in->A[i], in->B[i]);
+    bench_sink = in->V[in->n-1].x;
+}
+void vec_from_points_n(BenchInput *in)
+{
+    aff_vec_from_points_n(in->A, in->B, in->V, in->n);
+    bench_sink = in->V[in->n-1].x;
+}
+void join_of_points(BenchInput *in)
+{
+    for( int i=0; i<in->n; i++ )
+    {
+        AffLine l = aff_join_of_points(in->A[i], in->B[i]);
+        in->o1[i] = l.a; in->o2[i] = l.b; in->o3[i] = l.c;
+    }
+    bench_sink = in->o3[in->n-1];
+}
+void join_of_points_soa(BenchInput *in)
+{
+    aff_join_of_points_soa(in->ax, in->ay, in->bx, in->by, in->o1, in->o2, in->o3, in->n);
+    bench_sink = in->o3[in->n-1];
+}
+void meet_of_lines(BenchInput *in)
+{
+    for( int i=0; i<in->n; i++ )
+    {
+        AffPoint M = aff_meet_of_lines(in->L1[i], in->L2[i]);
+        in->o1[i] = M.x; in->o2[i] = M.y;
+    }
+    bench_sink = in->o1[in->n-1];
+}
+void meet_of_lines_soa(BenchInput *in)
+{
+    aff_meet_of_lines_soa(in->a1, in->b1, in->c1, in->a2, in->b2, in->c2, in->o1, in->o2, in->n);
+    bench_sink = in->o1[in->n-1];
+}
+void sarea_poly(BenchInput *in)      { bench_area = aff_sarea_poly(in->A, in->n); }
+void sarea_poly_d(BenchInput *in)    { bench_area = aff_sarea_poly_d(in->A, in->n); }
+void sarea_poly_soa(BenchInput *in)  { bench_area = aff_sarea_poly_soa(in->ax, in->ay, in->n); }
+
+typedef struct
+{
+    const char *name;
+    BenchFn fn;
+    bool per_side;                                              // Polygon : n-1 elements
+} BenchCase;
+
+long double bench_sarea_exact(BenchInput *in)
+{ // Reference signed area, long double sum
+    long double s = 0;
+    for( int i=0; i<in->n-1; i++ )
+    {
+        s += (long double)in->A[i].x*in->A[i+1].y - (long double)in->A[i+1].x*in->A[i].y;
+    }
+    return 0.5L*s;
+}
+
+void bench_run(const BenchCase *c, BenchInput *in)
+{ // Time c on in, print one row
+    int elems = c->per_side ? in->n-1 : in->n;
+    int calls = BENCH_MIN_CALLS/in->n; if(calls<1) {calls=1;}
+    double t[BENCH_REPS];
+    for( int r=-BENCH_WARMUP; r<BENCH_REPS; r++ )
+    {
+        double t0 = bench_now_ns();
+        for( int k=0; k<calls; k++ ) c->fn(in);
+        double dt = bench_now_ns() - t0;
+        if(  r >= 0  ) t[r] = dt/((double)calls*elems);
+    }
+    Stats st = stats_summary(t, BENCH_REPS);
+    printf("%-20s %-11s %6d %8.3f %8.3f %8.3f %8.3f %8.3f",
+            c->name, in->name, in->n, st.min, st.median, st.mean, st.stddev, st.p99);
+    if(  c->per_side  )
+    { // Relative error of the signed area
+        long double exact = bench_sarea_exact(in);
+        double err = (exact == 0) ? fabs(bench_area) : fabsl((bench_area - exact)/exact);
+        printf("  err %.1e", err);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = (argc > 1) ? argv[1] : NULL;           // Substring of bench name
+    BenchCase cases[] = {
+        {"vec_from_points",     vec_from_points,    false},
+        {"vec_from_points_n",   vec_from_points_n,  false},
+        {"join_of_points",      join_of_points,     false},
+        {"join_of_points_soa",  join_of_points_soa, false},
+        {"meet_of_lines",       meet_of_lines,      false},
+        {"meet_of_lines_soa",   meet_of_lines_soa,  false},
+        {"sarea_poly",          sarea_poly,         true},
+        {"sarea_poly_d",        sarea_poly_d,       true},
+        {"sarea_poly_soa",      sarea_poly_soa,     true},
+    };
+    int case_cnt = sizeof(cases)/sizeof(cases[0]);
+    BenchInput *in = malloc(sizeof(BenchInput));
+    struct { void (*make)(BenchInput *, int); int n; } sets[] = {
+        {bench_input_degenerate, 9},                            // fill-poly.c art size
+        {bench_input_degenerate, 1024},
+        {bench_input_random,     9},
+        {bench_input_random,     1024},
+        {bench_input_large,      BENCH_MAX_N},
+    };
+    int set_cnt = sizeof(sets)/sizeof(sets[0]);
+
+    printf("# ns per element\n");
+    printf("%-20s %-11s %6s %8s %8s %8s %8s %8s\n",
+            "bench", "input", "n", "min", "median", "mean", "stddev", "p99");
+    for( int c=0; c<case_cnt; c++ )
+    {
+        if(  filter && !strstr(cases[c].name, filter)  ) continue;
+        for( int s=0; s<set_cnt; s++ )
+        {
+            sets[s].make(in, sets[s].n);
+            bench_run(&cases[c], in);
+        }
+    }
+    free(in);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/* *************DOC***************
+ * Headless benchmark of the TV static and polygon fill workloads.
+ * No window, no renderer: just the generate/fill loops.
+ *
+ * $ ./bench.exe                            -- print metrics
+ * $ ./bench.exe .bench/host.txt            -- compare with baseline (gate 15%)
+ * $ ./bench.exe .bench/host.txt 5          -- fail if a metric is >5% worse
+ *
+ * Metrics (all lower-is-better):
+ *      noise_ns_per_point      : noise_fill_points, median over reps
+ *      noise_dist_ns_per_point : noise_dist_fill_points, gauss, exp, hist
+ *      fill_ns_per_span        : scanline fill of the fill-poly.c art
+ *      frame_p99_us            : noise + fill for one frame, 99th percentile
+ *      fill_zoom_us            : clip + fill of the art at view_s 500
+ *
+ * Baseline file format is the same as the output: "name value" lines,
+ * '#' starts a comment. Timings only compare on one machine, so make
+ * bench-check keeps a baseline per host (.bench/, not committed).
+ * *******************************/
+#include <SDL.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "noise.h"
+#include "noise_dist.h"
+#include "affine.h"
+#include "bench.h"
+
+#define BENCH_W         800                                     // Default window w
+#define BENCH_H         600                                     // Default window h
+#define BENCH_POINTS    5000                                    // Default static count
+#define BENCH_REPS      200                                     // Reps per metric
+#define BENCH_FRAMES    1000                                    // Frames for p99
+#define BENCH_WARMUP    20                                      // Untimed reps
+
+volatile float bench_sink;                                      // Keep results alive
+
+typedef struct
+{
+    const char *name;
+    double value;
+} BenchMetric;
+
+int bench_poly(AffPoint *poly, int view_s, AffPoint view_o)
+{ // Same art as fill-poly.c, mapped from model to view
+    poly[0] = (AffPoint){0, 1};
+    poly[1] = (AffPoint){2, 0};
+    poly[2] = (AffPoint){1, 1.5};
+    poly[3] = (AffPoint){2, 2.5};
+    poly[4] = (AffPoint){3, 2.5};
+    poly[5] = (AffPoint){2, 4};
+    poly[6] = (AffPoint){0, 5};
+    poly[7] = (AffPoint){-1, 2};
+    poly[8] = poly[0];
+    for( int i=0; i<9; i++ )
+    {
+        poly[i].x = poly[i].x*view_s + view_o.x;
+        poly[i].y = poly[i].y*view_s + view_o.y;
+    }
+    return 9;
+}
+
+int bench_fill(AffPoint *poly, int poly_cnt)
+{ // Scanline fill of poly, same as fill-poly.c. Return span count.
+    static AffPath path; static AffSpanList fill;               // Reused across reps
+    aff_path_clear(&path); fill.cnt = 0;
+    aff_path_add_contour(&path, poly, poly_cnt);
+    float top = poly[0].y; float bot = poly[0].y;
+    for( int i=0; i<poly_cnt; i++ )
+    {
+        if(  top > poly[i].y  ) { top = poly[i].y; }
+        if(  bot < poly[i].y  ) { bot = poly[i].y; }
+    }
+    int span_cnt = aff_path_spans(&path, AFF_FILL_NONZERO, (int)floorf(top), (int)ceilf(bot), &fill);
+    float acc = 0;
+    for( int i=0; i<span_cnt; i++ ) { acc += fill.s[i].x1 - fill.s[i].x0; }
+    bench_sink = acc;
+    return span_cnt;
+}
+
+double bench_noise_ns_per_point(void)
+{
+    SDL_FPoint *pts = malloc(sizeof(SDL_FPoint)*BENCH_POINTS);
+    int *alpha = malloc(sizeof(int)*BENCH_POINTS);
+    double t[BENCH_REPS];
+    for( int r=-BENCH_WARMUP; r<BENCH_REPS; r++ )
+    {
+        double t0 = bench_now_ns();
+        noise_fill_points(pts, alpha, 0, BENCH_POINTS, BENCH_W, BENCH_H, r, 1, 255);
+        double dt = bench_now_ns() - t0;
+        bench_sink = pts[r&1023].x + alpha[r&1023];
+        if(  r >= 0  ) t[r] = dt/BENCH_POINTS;
+    }
+    free(pts); free(alpha);
+    return stats_summary(t, BENCH_REPS).median;
+}
+
+double bench_noise_dist_ns_per_point(void)
+{ // Shaped static: one fill each of gauss, exp and hist per rep
+    static NoiseDist d; noise_dist_init(&d, NOISE_DIST_GAUSS);  // Big tables : not on the stack
+    NoiseDistKind kinds[] = {NOISE_DIST_GAUSS, NOISE_DIST_EXP, NOISE_DIST_HIST};
+    SDL_FPoint *pts = malloc(sizeof(SDL_FPoint)*BENCH_POINTS);
+    int *alpha = malloc(sizeof(int)*BENCH_POINTS);
+    double t[BENCH_REPS];
+    for( int r=-BENCH_WARMUP; r<BENCH_REPS; r++ )
+    {
+        double t0 = bench_now_ns();
+        for( int k=0; k<3; k++ )
+        {
+            d.kind = kinds[k];
+            noise_dist_fill_points(&d, pts, alpha, 0, BENCH_POINTS, BENCH_W, BENCH_H, r, 1, 255);
+            bench_sink += alpha[(r+k)&1023];
+        }
+        double dt = bench_now_ns() - t0;
+        if(  r >= 0  ) t[r] = dt/(3.0*BENCH_POINTS);
+    }
+    free(pts); free(alpha);
+    return stats_summary(t, BENCH_REPS).median;
+}
+
+double bench_fill_ns_per_span(void)
+{
+    AffPoint poly[9]; int poly_cnt = bench_poly(poly, 122, (AffPoint){200, 0});
+    double t[BENCH_REPS];
+    for( int r=-BENCH_WARMUP; r<BENCH_REPS; r++ )
+    {
+        double t0 = bench_now_ns();
+        int spans = bench_fill(poly, poly_cnt);
+        double dt = bench_now_ns() - t0;
+        if(  r >= 0  ) t[r] = dt/(spans>0 ? spans : 1);
+    }
+    return stats_summary(t, BENCH_REPS).median;
+}
+
+double bench_fill_zoom_us(void)
+{ // Zoomed all the way in: clip to the window, fill only visible rows
+    AffPoint poly[9]; int poly_cnt = bench_poly(poly, 500, (AffPoint){200, 0});
+    AffPath path = {0}; AffPath clip = {0}; AffSpanList fill = {0};
+    aff_path_add_contour(&path, poly, poly_cnt);
+    double t[BENCH_REPS];
+    for( int r=-BENCH_WARMUP; r<BENCH_REPS; r++ )
+    {
+        double t0 = bench_now_ns();
+        aff_path_clip(&path, (SDL_FRect){-2, -2, BENCH_W+4, BENCH_H+4}, &clip);
+        fill.cnt = 0;
+        aff_path_spans(&clip, AFF_FILL_NONZERO, 0, BENCH_H, &fill);
+        double dt = bench_now_ns() - t0;
+        bench_sink = fill.cnt ? fill.s[0].x1 : 0;
+        if(  r >= 0  ) t[r] = dt/1e3;
+    }
+    aff_path_free(&path); aff_path_free(&clip); free(fill.s);
+    return stats_summary(t, BENCH_REPS).median;
+}
+
+double bench_frame_p99_us(void)
+{ // One frame: alloc, generate static, map and fill polygon, free
+    double t[BENCH_FRAMES];
+    for( int r=-BENCH_WARMUP; r<BENCH_FRAMES; r++ )
+    {
+        double t0 = bench_now_ns();
+        {
+            SDL_FPoint *pts = malloc(sizeof(SDL_FPoint)*BENCH_POINTS);
+            int *alpha = malloc(sizeof(int)*BENCH_POINTS);
+            noise_fill_points(pts, alpha, 0, BENCH_POINTS, BENCH_W, BENCH_H, r, 1, 255);
+            AffPoint poly[9]; int poly_cnt = bench_poly(poly, 122, (AffPoint){200, 0});
+            bench_fill(poly, poly_cnt);
+            bench_sink += pts[r&1023].y + alpha[r&1023];
+            free(pts); free(alpha);
+        }
+        double dt = bench_now_ns() - t0;
+        if(  r >= 0  ) t[r] = dt/1e3;
+    }
+    return stats_summary(t, BENCH_FRAMES).p99;
+}
+
+int bench_compare(const char *path, BenchMetric *m, int n, double threshold)
+{
+    /* *************DOC***************
+     * Compare metrics m against the baseline file at path.
+     * Return the number of metrics that regressed past threshold percent.
+     * A metric missing from the baseline, or with a baseline of 0 (no
+     * percent change), is reported but never fails.
+     * *******************************/
+    FILE *f = fopen(path, "r");
+    if(  f == NULL  ) { printf("Cannot open baseline: %s\n", path); return -1; }
+    double base[n]; bool found[n];
+    for( int i=0; i<n; i++ ) { found[i] = false; }
+    char line[256];
+    while(  fgets(line, sizeof(line), f)  )
+    {
+        char name[128]; double v;
+        if(  line[0] == '#'  ) continue;
+        if(  sscanf(line, "%127s %lf", name, &v) != 2  ) continue;
+        for( int i=0; i<n; i++ )
+        {
+            if(  strcmp(name, m[i].name) == 0  ) { base[i] = v; found[i] = true; }
+        }
+    }
+    fclose(f);
+
+    int regressed = 0;
+    printf("%-24s %12s %12s %8s\n", "metric", "baseline", "current", "change");
+    for( int i=0; i<n; i++ )
+    {
+        if(  !found[i]  ) { printf("%-24s %12s %12.3f %8s\n", m[i].name, "-", m[i].value, "new"); continue; }
+        if(  base[i] <= 0  ) { printf("%-24s %12.3f %12.3f %8s\n", m[i].name, base[i], m[i].value, "no base"); continue; }
+        double pct = 100*(m[i].value - base[i])/base[i];
+        bool bad = pct > threshold;
+        printf("%-24s %12.3f %12.3f %+7.1f%%%s\n", m[i].name, base[i], m[i].value, pct, bad ? "  REGRESSED" : "");
+        if(  bad  ) regressed++;
+    }
+    return regressed;
+}
+
+int main(int argc, char *argv[])
+{
+    double threshold = 15;                                      // Percent
+    if(argc>2) threshold = atof(argv[2]);
+
+    BenchMetric m[] = {
+        {"noise_ns_per_point",      bench_noise_ns_per_point()},
+        {"noise_dist_ns_per_point", bench_noise_dist_ns_per_point()},
+        {"fill_ns_per_span",        bench_fill_ns_per_span()},
+        {"frame_p99_us",            bench_frame_p99_us()},
+        {"fill_zoom_us",            bench_fill_zoom_us()},
+    };
+    int n = sizeof(m)/sizeof(m[0]);
+
+    if(  argc < 2  )                                            // Print metrics
+    {
+        for( int i=0; i<n; i++ ) { printf("%s %.3f\n", m[i].name, m[i].value); }
+        return EXIT_SUCCESS;
+    }
+    int regressed = bench_compare(argv[1], m, n, threshold);
+    if(  regressed != 0  )
+    {
+        if(  regressed > 0  ) printf("%d metric(s) regressed more than %.1f%%\n", regressed, threshold);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+/* *************DOC***************
+ * Timing for headless benchmarks.
+ *
+ * Call bench_now_ns() before and after the work.
+ * Collect one sample per repetition, then call stats_summary() (stats.h).
+ * *******************************/
+/* *************Example***************
+ *      double t[REPS];
+ *      for(int r=0; r<REPS; r++)
+ *      {
+ *          Uint64 t0 = bench_now_ns();
+ *          work();
+ *          t[r] = bench_now_ns() - t0;
+ *      }
+ *      Stats st = stats_summary(t, REPS);                // sorts t
+ * *******************************/
+#include "stats.h"
+
+double bench_now_ns(void)
+{ // Nanoseconds from the high-resolution counter
+    static double ns_per_tick = 0;
+    if(  ns_per_tick == 0  ) ns_per_tick = 1e9/SDL_GetPerformanceFrequency();
+    return SDL_GetPerformanceCounter()*ns_per_tick;
+}
+
+#endif // __BENCH_H__
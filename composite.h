@@ -0,0 +1,175 @@
+#ifndef __COMPOSITE_H__
+#define __COMPOSITE_H__
+/* *************DOC***************
+ * Single-pass CPU compositor.
+ *
+ * SDL draws each layer as its own pass: clear the screen, blend every fill
+ * line, blend every static point. Each pass reads and writes the frame.
+ *
+ * comp_frame() builds the frame one row at a time instead. All layers are
+ * applied to the row while it is in cache, then the next row:
+ *
+ *      1. background   : opaque color
+ *      2. fill spans   : one premultiplied color, [x0, x1) on row y
+ *      3. static       : white, alpha from a w*h alpha plane
+ *
+ * Pixels are ARGB8888, alpha premultiplied:
+ *
+ *      out = src + dst*(255-src.a)/255
+ *
+ * The static layer is the per-pixel blend: SSE2 does 4 pixels at a time,
+ * AVX2 does 8 (build with -msse2/-mavx2 or -march=native to enable).
+ *
+ * Upload once: lock a streaming texture and composite straight into it.
+ * *******************************/
+/* *************Example***************
+ *      Uint32 *px; int pitch;
+ *      SDL_LockTexture(tex, NULL, (void **)&px, &pitch);
+ *      comp_frame(px, pitch/4, w, h, bg, spans, span_cnt, fill, noise);
+ *      SDL_UnlockTexture(tex);
+ *      SDL_RenderCopy(ren, tex, NULL, NULL);
+ * *******************************/
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+typedef struct
+{
+    int y, x0, x1;                                              // Row y, columns [x0, x1)
+} CompSpan;
+
+uint32_t comp_argb(int r, int g, int b, int a)
+{ // Premultiplied ARGB8888 from straight (non-premultiplied) r,g,b,a
+    r = (r*a + 127)/255; g = (g*a + 127)/255; b = (b*a + 127)/255;
+    return ((uint32_t)a<<24) | ((uint32_t)r<<16) | ((uint32_t)g<<8) | (uint32_t)b;
+}
+
+uint32_t comp_mul255(uint32_t x)
+{ // x/255 rounded, exact for x <= 255*255
+    x += 128;
+    return (x + (x>>8)) >> 8;
+}
+
+uint32_t comp_over(uint32_t src, uint32_t dst)
+{ // Premultiplied src over dst, one pixel
+    uint32_t k = 255 - (src>>24);
+    uint32_t out = 0;
+    for( int s=0; s<32; s+=8 )
+    {
+        uint32_t c = ((src>>s)&0xFF) + comp_mul255(((dst>>s)&0xFF)*k);
+        out |= (c>255 ? 255 : c) << s;
+    }
+    return out;
+}
+
+void comp_noise_row(uint32_t *row, const uint8_t *a, int n)
+{
+    /* *************DOC***************
+     * Blend white static over n pixels: src = (a,a,a,a) premultiplied.
+     * *******************************/
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i c128 = _mm256_set1_epi16(128);
+    for( ; i+8<=n; i+=8 )
+    {
+        __m128i a8 = _mm_loadl_epi64((const __m128i *)(a+i));  // 8 alphas
+        __m128i a16 = _mm_unpacklo_epi8(a8, a8);                // a0a0 a1a1 ...
+        __m256i aa = _mm256_inserti128_si256(                   // Each alpha x4 channels
+                        _mm256_castsi128_si256(_mm_unpacklo_epi16(a16, a16)),
+                        _mm_unpackhi_epi16(a16, a16), 1);
+        __m256i d = _mm256_loadu_si256((const __m256i *)(row+i));
+        __m256i alo = _mm256_unpacklo_epi8(aa, zero); __m256i ahi = _mm256_unpackhi_epi8(aa, zero);
+        __m256i dlo = _mm256_unpacklo_epi8(d, zero);  __m256i dhi = _mm256_unpackhi_epi8(d, zero);
+        dlo = _mm256_add_epi16(_mm256_mullo_epi16(dlo, _mm256_sub_epi16(c255, alo)), c128);
+        dhi = _mm256_add_epi16(_mm256_mullo_epi16(dhi, _mm256_sub_epi16(c255, ahi)), c128);
+        dlo = _mm256_srli_epi16(_mm256_add_epi16(dlo, _mm256_srli_epi16(dlo, 8)), 8);
+        dhi = _mm256_srli_epi16(_mm256_add_epi16(dhi, _mm256_srli_epi16(dhi, 8)), 8);
+        d = _mm256_adds_epu8(_mm256_packus_epi16(dlo, dhi), aa);
+        _mm256_storeu_si256((__m256i *)(row+i), d);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i c128 = _mm_set1_epi16(128);
+    for( ; i+4<=n; i+=4 )
+    {
+        uint32_t a4; memcpy(&a4, a+i, 4);                       // 4 alphas
+        __m128i a16 = _mm_cvtsi32_si128((int)a4);
+        a16 = _mm_unpacklo_epi8(a16, a16);                      // a0a0 a1a1 ...
+        __m128i aa = _mm_unpacklo_epi16(a16, a16);              // Each alpha x4 channels
+        __m128i d = _mm_loadu_si128((const __m128i *)(row+i));
+        __m128i alo = _mm_unpacklo_epi8(aa, zero); __m128i ahi = _mm_unpackhi_epi8(aa, zero);
+        __m128i dlo = _mm_unpacklo_epi8(d, zero);  __m128i dhi = _mm_unpackhi_epi8(d, zero);
+        dlo = _mm_add_epi16(_mm_mullo_epi16(dlo, _mm_sub_epi16(c255, alo)), c128);
+        dhi = _mm_add_epi16(_mm_mullo_epi16(dhi, _mm_sub_epi16(c255, ahi)), c128);
+        dlo = _mm_srli_epi16(_mm_add_epi16(dlo, _mm_srli_epi16(dlo, 8)), 8);
+        dhi = _mm_srli_epi16(_mm_add_epi16(dhi, _mm_srli_epi16(dhi, 8)), 8);
+        d = _mm_adds_epu8(_mm_packus_epi16(dlo, dhi), aa);
+        _mm_storeu_si128((__m128i *)(row+i), d);
+    }
+#endif
+    for( ; i<n; i++ )                                           // Scalar tail
+    {
+        uint32_t s = a[i]; s |= s<<8; s |= s<<16;               // (a,a,a,a)
+        row[i] = comp_over(s, row[i]);
+    }
+}
+
+void comp_frame(uint32_t *px, int pitch, int w, int h, uint32_t bg,
+                const CompSpan *spans, int span_cnt, uint32_t fill,
+                const uint8_t *noise)
+{
+    /* *************DOC***************
+     * Composite one frame into px (pitch in pixels, not bytes).
+     *
+     * bg       : opaque background color
+     * spans    : sorted by y, clipped here to the frame
+     * fill     : premultiplied fill color for all spans
+     * noise    : w*h static alpha plane, or NULL for no static
+     * *******************************/
+    uint32_t bg_fill = comp_over(fill, bg);                     // Fill over bg : constant
+    int s = 0;                                                  // Next span
+    while(  (s < span_cnt) && (spans[s].y < 0)  ) s++;          // Skip rows above frame
+    for( int y=0; y<h; y++ )
+    {
+        uint32_t *row = px + (size_t)y*pitch;
+        for( int x=0; x<w; x++ ) row[x] = bg;                   // 1. background
+        for( ; (s < span_cnt) && (spans[s].y == y); s++ )       // 2. fill spans
+        {
+            int x0 = spans[s].x0 < 0 ? 0 : spans[s].x0;
+            int x1 = spans[s].x1 > w ? w : spans[s].x1;
+            for( int x=x0; x<x1; x++ ) row[x] = bg_fill;
+        }
+        if(  noise  ) comp_noise_row(row, noise + (size_t)y*w, w);   // 3. static
+    }
+}
+
+void comp_scatter_points(uint8_t *noise, int w, int h, const SDL_FPoint *pts, const int *alpha, int n)
+{ // Clear the static alpha plane, then blend each point's alpha onto its pixel
+    /* *************DOC***************
+     * Points on the same pixel blend like SDL's per-point draws: white over
+     * white is white, so only the alpha adds up, a over d is
+     *
+     *      a + d*(255-a)/255
+     *
+     * and the plane then blends over the frame as one layer. Over is
+     * associative, so this matches drawing the points one at a time.
+     * *******************************/
+    memset(noise, 0, (size_t)w*h);
+    for( int i=0; i<n; i++ )
+    {
+        int x = (int)pts[i].x; int y = (int)pts[i].y;
+        if(  (x < 0) || (x >= w) || (y < 0) || (y >= h)  ) continue;
+        uint8_t *d = &noise[(size_t)y*w + x];
+        uint32_t a = (uint32_t)alpha[i];
+        *d = (uint8_t)(a + comp_mul255((uint32_t)*d*(255-a)));
+    }
+}
+
+#endif // __COMPOSITE_H__
@@ -1,76 +1,209 @@
 #include <SDL.h>
 #include <stdbool.h>
+#include <math.h>
 #include "main.h"
 #include "window_info.h"
+#include "affine.h"
+#include "noise.h"
+#include "composite.h"
+#include "latency.h"
+#include "trace.h"
+#include "renderer_info.h"
 
-typedef SDL_FPoint AffPoint;                                    // point
-typedef AffPoint AffVec;                                        // vector
+// View polygon artwork
+AffPoint view_o = {200, 0};                                   // origin
+int view_s = 122;                                             // scale
+// DEBUG by moving scanline manually
+int Y = 0;                                                    // scanline y set by UI
+// CPU compositor : bgnd, fill, and TV static in one pass (toggle with c)
+bool comp_on = false;
+int tv_max = 100;                                             // TV alpha max over the art
+// Artwork (pick with 1, 2, 3) and its fill rule (toggle with f)
+int art = 1;
+AffFillRule fill_rule = AFF_FILL_NONZERO;
 
-AffVec aff_vec_from_points(AffPoint A, AffPoint B)
-{ // Return vector AB (the vector that goes from A to B)
-    return (AffPoint){B.x-A.x, B.y-A.y};
+void art_heart(AffCurvePath *cp)
+{ // Heart outline with a round cutout, all Bezier curves
+    aff_curve_move_to(cp, (AffPoint){1, 1});
+    aff_curve_cubic_to(cp, (AffPoint){1, -0.2}, (AffPoint){3.2, -0.2}, (AffPoint){3, 1.8});
+    aff_curve_quad_to(cp, (AffPoint){2.6, 3.4}, (AffPoint){1, 5});
+    aff_curve_quad_to(cp, (AffPoint){-0.6, 3.4}, (AffPoint){-1, 1.8});
+    aff_curve_cubic_to(cp, (AffPoint){-1.2, -0.2}, (AffPoint){1, -0.2}, (AffPoint){1, 1});
+    // Circle r=0.6 at (1,2.4), four cubics, wound the other way
+    float r = 0.6; float k = 0.5523*r; float cx = 1; float cy = 2.4;
+    aff_curve_move_to(cp, (AffPoint){cx+r, cy});
+    aff_curve_cubic_to(cp, (AffPoint){cx+r, cy-k}, (AffPoint){cx+k, cy-r}, (AffPoint){cx, cy-r});
+    aff_curve_cubic_to(cp, (AffPoint){cx-k, cy-r}, (AffPoint){cx-r, cy-k}, (AffPoint){cx-r, cy});
+    aff_curve_cubic_to(cp, (AffPoint){cx-r, cy+k}, (AffPoint){cx-k, cy+r}, (AffPoint){cx, cy+r});
+    aff_curve_cubic_to(cp, (AffPoint){cx+k, cy+r}, (AffPoint){cx+r, cy+k}, (AffPoint){cx+r, cy});
 }
-typedef struct
-{
-    AffPoint A, B;
-} AffSeg;
-// Alias affine segments as oriented sides
-typedef AffSeg AffOrS;                                          // oriented side
-float aff_sarea_poly(AffPoint *poly, int n)
-{ // Signed area of polygon with n points
-    /* *************DOC***************
-     * Uses definition of signed area of a polygon as the sum of
-     * the signed areas of each oriented side.
-     *
-     * The order of the points (clockwise or counter clockwise)
-     * affects the sign of the signed area.
-     *
-     * clockwise            : signed area is positive
-     * counter-clockwise    : signed area is negative
-     * *******************************/
-    float s = 0;                                                // Total signed area
-    AffVec u,v;
-    for(int i=0; i<(n-1); i++)
+
+void art_blob(AffPath *path)
+{ // Wobbly outline with a wobbly cutout, thousands of vertices
+    enum { N = 4000 };
+    static AffPoint pts[N];
+    for( int hole=0; hole<2; hole++ )
     {
-        u = poly[i]; v = poly[i+1];
-        s += 0.5*(u.x*v.y - v.x*u.y);
+        for( int i=0; i<N; i++ )
+        {
+            float t = 2*M_PI*i/N; if(hole) {t = -t;}            // Cutout winds the other way
+            float r = hole ? 0.7 + 0.1*sinf(5*t) : 2 + 0.3*sinf(7*t) + 0.08*sinf(61*t);
+            pts[i] = (AffPoint){1 + r*cosf(t), 2.5 + r*sinf(t)};
+        }
+        aff_path_add_contour(path, pts, N);
     }
-    return s;
 }
 
+void art_model(AffPath *path, int which)
+{ // Build artwork in model coordinates
+    aff_path_clear(path);
+    if(  which == 5  )
+    { // Many vertices: simplified to 1/2 pixel on screen, level picked by zoom
+        static AffLod blob_lod; static bool built = false;
+        if(  !built  )
+        {
+            AffPath blob = {0}; art_blob(&blob);
+            aff_lod_build(&blob_lod, &blob, 0.5);
+            aff_path_free(&blob); built = true;
+        }
+        aff_path_append(path, aff_lod_pick(&blob_lod, view_s));
+    }
+    else if(  which == 4  )
+    { // Curves: flattened for 1/4 pixel on screen, re-flattened per zoom bucket
+        static AffCurvePath heart; static AffFlatCache heart_flat;
+        if(  heart.seg_cnt == 0  ) art_heart(&heart);
+        aff_path_append(path, aff_flat_cache_get(&heart_flat, &heart, view_s, 0.25));
+    }
+    else if(  which == 2  )
+    { // Glyph-like: outline with a 3x4 grid of cutouts (cutouts wind the other way)
+        AffPoint outline[] = {{-1,0}, {3,0}, {3,5}, {-1,5}};
+        aff_path_add_contour(path, outline, 4);
+        for( int r=0; r<4; r++ ) for( int c=0; c<3; c++ )
+        {
+            float x = -0.7 + c*1.25; float y = 0.3 + r*1.2;
+            AffPoint hole[] = {{x,y}, {x,y+0.8}, {x+0.9,y+0.8}, {x+0.9,y}};
+            aff_path_add_contour(path, hole, 4);
+        }
+    }
+    else if(  which == 3  )
+    { // Pentagram: one contour that crosses itself, nonzero fills the middle
+        AffPoint star[] = {{1,0}, {2.18,3.62}, {-0.9,1.38}, {2.9,1.38}, {-0.18,3.62}};
+        aff_path_add_contour(path, star, 5);
+    }
+    else
+    {
+        AffPoint poly[] = {{0,1}, {2,0}, {1,1.5}, {2,2.5}, {3,2.5}, {2,4}, {0,5}, {-1,2}};
+        aff_path_add_contour(path, poly, 8);
+    }
+}
+
+/* *************Renderer compare***************
+ * TV_RENDERER=compare : time both render paths on each backend
+ * (renderer_info.h): build, clip and fill the current art, draw it.
+ * *******************************/
 typedef struct
 {
-    float a,b,c;
-} AffLine;                                                      // line (infinite extent)
-AffLine aff_join_of_points(AffPoint A, AffPoint B)
-{ // Return join of points A and B
-    float alpha = B.x-A.x; float beta = B.y-A.y;
-    float c = -1*beta*A.x + alpha*A.y;
-    AffLine l = {-1*beta, alpha, c};
-    return l;
+    int w, h;
+    AffPath path, clip;                                         // Art in view, in window
+    AffSpanList fill;
+    CompSpan *spans; int span_cap;
+    SDL_FPoint *pts; int *alpha; int count;                     // Static points
+    uint8_t *plane;                                             // Static alpha plane
+    SDL_Texture *tex;                                           // Composited frame
+} FillLoad;
+
+void fill_load_spans(FillLoad *L)
+{ // Art in model -> view -> clipped -> spans
+    art_model(&L->path, art);
+    for( int i=0; i<L->path.pt_cnt; i++ )
+    {
+        L->path.pts[i].x = L->path.pts[i].x*view_s + view_o.x;
+        L->path.pts[i].y = L->path.pts[i].y*view_s + view_o.y;
+    }
+    aff_path_clip(&L->path, (SDL_FRect){-2, -2, L->w+4, L->h+4}, &L->clip);
+    L->fill.cnt = 0;
+    aff_path_spans(&L->clip, fill_rule, 0, L->h, &L->fill);
 }
-AffPoint aff_meet_of_lines(AffLine l1, AffLine l2)
-{ // Return meet of lines l1 and l2 <--? What happens if lines don't intersect?
-    /* *************DOC***************
-     * TODO:
-     * - Return meet by passing meet as a pointer arg
-     * - Use return value for a success/fail (meet/no-meet)
-     * *******************************/
-    float a1 = l1.a; float b1 = l1.b; float c1 = l1.c;
-    float a2 = l2.a; float b2 = l2.b; float c2 = l2.c;
-    float det = 1/(a1*b2 - a2*b1);                              // What happens when 1/0?
-    float x = det*(b2*c1 - b1*c2);
-    float y = det*(a1*c2 - a2*c1);
-    AffPoint M = {x,y};
-    return M;
+
+void fill_load_sdl(SDL_Renderer *ren, int frame_cnt, void *data)
+{ // SDL path: clear, a line per span, outline, present
+    FillLoad *L = data;
+    if(  frame_cnt < 0  ) return;
+    if(  frame_cnt == 0  ) SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+    fill_load_spans(L);
+    SDL_SetRenderDrawColor(ren, 10, 10, 10, 0);
+    SDL_RenderClear(ren);
+    SDL_SetRenderDrawColor(ren, 200, 200, 10, 100);
+    for( int i=0; i<L->fill.cnt; i++ )
+    {
+        SDL_RenderDrawLineF(ren, L->fill.s[i].x0, L->fill.s[i].y, L->fill.s[i].x1, L->fill.s[i].y);
+    }
+    SDL_SetRenderDrawColor(ren, 255, 100, 10, 255);
+    for( int c=0; c<L->clip.contour_cnt; c++ )
+    {
+        int start = aff_path_start(&L->clip, c);
+        SDL_RenderDrawLinesF(ren, L->clip.pts+start, L->clip.ends[c]-start);
+    }
+    SDL_RenderPresent(ren);
 }
 
+void fill_load_composite(SDL_Renderer *ren, int frame_cnt, void *data)
+{ // CPU compositor path: bgnd, fill and static in one pass, present
+    FillLoad *L = data;
+    if(  frame_cnt < 0  ) { SDL_DestroyTexture(L->tex); L->tex = NULL; return; }
+    if(  frame_cnt == 0  ) L->tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+                                                      SDL_TEXTUREACCESS_STREAMING, L->w, L->h);
+    fill_load_spans(L);
+    if(  L->fill.cnt > L->span_cap  )
+    {
+        L->span_cap = L->fill.cnt;
+        L->spans = realloc(L->spans, sizeof(CompSpan)*L->span_cap);
+    }
+    for( int i=0; i<L->fill.cnt; i++ )
+    {
+        AffSpan f = L->fill.s[i];
+        L->spans[i] = (CompSpan){f.y, (int)ceilf(f.x0-0.5), (int)ceilf(f.x1-0.5)};
+    }
+    noise_fill_points(L->pts, L->alpha, 0, L->count, L->w, L->h, frame_cnt, 0, tv_max);
+    comp_scatter_points(L->plane, L->w, L->h, L->pts, L->alpha, L->count);
+    Uint32 *px; int pitch;
+    SDL_LockTexture(L->tex, NULL, (void **)&px, &pitch);
+    comp_frame(px, pitch/4, L->w, L->h, comp_argb(10, 10, 10, 255),
+               L->spans, L->fill.cnt, comp_argb(200, 200, 10, 100), L->plane);
+    SDL_UnlockTexture(L->tex);
+    SDL_RenderCopy(ren, L->tex, NULL, NULL);
+    SDL_RenderPresent(ren);
+}
 
-// View polygon artwork
-AffPoint view_o = {200, 0};                                   // origin
-int view_s = 122;                                             // scale
-// DEBUG by moving scanline manually
-int Y = 0;                                                    // scanline y set by UI
+int fill_compare(RendererInfo *rI, const char *title, WindowInfo *wI)
+{ // Compare backends, then quit
+    FillLoad L = {.w = wI->w, .h = wI->h};
+    L.count = 5000.0/(800*600)*L.w*L.h;                         // Same density as tv-static
+    L.pts = malloc(sizeof(SDL_FPoint)*L.count);
+    L.alpha = malloc(sizeof(int)*L.count);
+    L.plane = malloc((size_t)L.w*L.h);
+    RendererWorkload loads[] = {
+        {"sdl",         fill_load_sdl,          &L},
+        {"composite",   fill_load_composite,    &L},
+    };
+    RendererInfo_compare(rI, title, wI, loads, 2);
+    aff_path_free(&L.path); aff_path_free(&L.clip); free(L.fill.s); free(L.spans);
+    free(L.pts); free(L.alpha); free(L.plane);
+    SDL_Quit();
+    return EXIT_SUCCESS;
+}
+
+Uint64 fill_look(const AffSpanList *fill)
+{ // Hash of the fill on screen (latency.h look)
+    Uint64 look = 14695981039346656037ull;                      // FNV-1a
+    for( int i=0; i<fill->cnt; i++ )
+    {
+        float v[] = {fill->s[i].x0, fill->s[i].x1, fill->s[i].y};
+        Uint32 u[3]; memcpy(u, v, sizeof(u));
+        for( int k=0; k<3; k++ ) { look ^= u[k]; look *= 1099511628211ull; }
+    }
+    return look;
+}
 
 void shutdown()
 {
@@ -86,12 +219,26 @@ int main(int argc, char *argv[])
     // Setup
     SDL_Init(SDL_INIT_VIDEO);
     WindowInfo wI; WindowInfo_setup(&wI, argc, argv);           // Init game window info
+    LatencyInfo lI; LatencyInfo_setup(&lI, SDLK_TAB);           // Input-to-photon latency, TAB : next art
+    TRACE_THREAD("main");                                       // Trace row
+    RendererInfo rI; RendererInfo_setup(&rI);                   // Render backend and flags
+    if(  rI.compare  ) return fill_compare(&rI, argv[0], &wI);  // Time each backend, quit
     win = SDL_CreateWindow(argv[0], wI.x, wI.y, wI.w, wI.h, wI.flags);
-    ren = SDL_CreateRenderer(win, -1, 0);
+    ren = RendererInfo_create(&rI, win);
     SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);       // Draw with alpha
 
     // Game state
     bool quit = false;
+    int frame_limit = getenv("TV_FRAMES") ? atoi(getenv("TV_FRAMES")) : 0; // 0 : run until Esc
+    int frame_cnt = 0;                                          // Frames presented
+    SDL_Texture *comp_tex = NULL; int comp_w = 0; int comp_h = 0; // Composited frame
+    uint8_t *comp_plane = NULL;                                 // Static alpha plane
+    CompSpan *spans = NULL; int span_cap = 0;                   // Fill spans
+    AffPath path = {0};                                         // Artwork in view
+    AffPath clip = {0};                                         // Artwork in window
+    AffPath comp_path = {0};                                    // Artwork in output pixels
+    AffSpanList fill = {0};                                     // Scanline fill of path
+    AffPoint topmost = {0}, botmost = {0};                      // Last frame's, for the UI
     // Game loop
     while(  quit == false  )
     {
@@ -99,44 +246,10 @@ int main(int argc, char *argv[])
         // Some game state depends on window size
         SDL_GetWindowSize(win, &wI.w, &wI.h);                   // Get new window size
 
-        // Procedurally generated art
-        int poly_cnt = 9; AffPoint *poly;                       // Polygon
-        {
-            poly = malloc(sizeof(AffPoint)*poly_cnt);           // Alloc mem for polygon
-
-            poly[0] = (AffPoint){0, 1};
-            poly[1] = (AffPoint){2, 0};
-            poly[2] = (AffPoint){1, 1.5};
-            poly[3] = (AffPoint){2, 2.5};
-            poly[4] = (AffPoint){3, 2.5};
-            poly[5] = (AffPoint){2, 4};
-            poly[6] = (AffPoint){0, 5};
-            poly[7] = (AffPoint){-1, 2};
-            poly[8] = poly[0];
-        }
-        { // map poly from model to view
-            for( int i=0; i<poly_cnt; i++ )
-            {
-                poly[i].x *= view_s;
-                poly[i].y *= view_s;
-                poly[i].x += view_o.x;
-                poly[i].y += view_o.y;
-            }
-        }
-        AffPoint topmost, botmost;
-        { // fill the polygon
-            { // find the top-most and bottom-most vertex
-                topmost = poly[0]; botmost = poly[0];
-                for( int i=0; i<poly_cnt; i++ )
-                {
-                    if(  topmost.y > poly[i].y  ) { topmost = poly[i]; }
-                    if(  botmost.y < poly[i].y  ) { botmost = poly[i]; }
-                }
-            }
-        }
-
-        // UI
+        // UI : first, so input is in the frame made below
         SDL_Keymod kmod = SDL_GetModState();
+        LatencyInfo_synth(&lI, frame_cnt);                      // Headless key presses
+        TRACE_BLOCK("Filtered keys")
         { // Filtered (rapid fire keys)
             SDL_PumpEvents();
             const Uint8 *k = SDL_GetKeyboardState(NULL);        // Get all keys
@@ -156,15 +269,29 @@ int main(int argc, char *argv[])
                 }
             }
         }
+        TRACE_BLOCK("Polled keys")
         { // Polled
             SDL_Event e;
             while(  SDL_PollEvent(&e)  )
             {
                 if(  e.type == SDL_KEYDOWN  )
                 {
+                    int art_was = art; int Y_was = Y; int view_s_was = view_s;
+                    int fill_rule_was = fill_rule;
                     switch( e.key.keysym.sym)
                     {
                         case SDLK_ESCAPE: quit = true; break;
+                        case SDLK_c: comp_on = !comp_on; break;
+                        case SDLK_t: TRACE_DUMP(); break;       // Dump trace (TRACE builds)
+                        case SDLK_f:                            // Toggle fill rule
+                            fill_rule = (fill_rule == AFF_FILL_NONZERO) ? AFF_FILL_EVENODD : AFF_FILL_NONZERO;
+                            break;
+                        case SDLK_1: art = 1; break;            // Polygon
+                        case SDLK_2: art = 2; break;            // Glyph w cutouts
+                        case SDLK_3: art = 3; break;            // Pentagram
+                        case SDLK_4: art = 4; break;            // Bezier heart
+                        case SDLK_5: art = 5; break;            // Blob, level of detail
+                        case SDLK_TAB: art = art%5 + 1; break;  // Next art
                         case SDLK_UP:
                               if(  kmod&KMOD_CTRL  )
                               { Y--; if(Y<topmost.y) {Y=topmost.y;} }
@@ -179,19 +306,126 @@ int main(int argc, char *argv[])
                               break;
                         default: break;
                     }
+                    bool changed = (art != art_was) || (Y != Y_was) || (view_s != view_s_was)
+                                || ((int)fill_rule != fill_rule_was);
+                    if(  changed  ) LatencyInfo_input(&lI, &e); // Stamp : a later frame shows it
+                }
+            }
+        }
+        Uint32 seq = LatencyInfo_publish(&lI);                  // This frame has the input
+
+        // Procedurally generated art
+        TRACE_BLOCK("Build art") art_model(&path, art);        // Path
+        TRACE_BLOCK("map poly from model to view")
+        { // map path from model to view
+            for( int i=0; i<path.pt_cnt; i++ )
+            {
+                path.pts[i].x *= view_s;
+                path.pts[i].y *= view_s;
+                path.pts[i].x += view_o.x;
+                path.pts[i].y += view_o.y;
+            }
+        }
+        TRACE_BLOCK("Clip to window")
+        { // clip path to window (2 pixel margin hides the sides it adds)
+            SDL_FRect r = {-2, -2, wI.w+4, wI.h+4};
+            aff_path_clip(&path, r, &clip);
+        }
+        // DEBUG scanline steps through the first contour
+        int poly_cnt = path.ends[0]; AffPoint *poly = path.pts;
+        TRACE_BLOCK("Find top and bottom")
+        { // fill the polygon
+            { // find the top-most and bottom-most vertex
+                topmost = path.pts[0]; botmost = path.pts[0];
+                for( int i=0; i<path.pt_cnt; i++ )
+                {
+                    if(  topmost.y > path.pts[i].y  ) { topmost = path.pts[i]; }
+                    if(  botmost.y < path.pts[i].y  ) { botmost = path.pts[i]; }
                 }
             }
         }
 
         // Render
+        if(  !comp_on  ) // SDL : one pass per layer
+        TRACE_BLOCK("Grey Bgnd")
         { // Grey Bgnd
             SDL_SetRenderDrawColor(ren, 10, 10, 10, 0);          // Alpha doesn't matter here
             SDL_RenderClear(ren);
         }
-        { // Draw Polygon
+        int span_cnt = 0;                                       // Fill spans for compositor
+        if(1) // scanline : fill path, all contours in one sweep
+        TRACE_BLOCK("Fill the polygon")
+        { // Fill the polygon
+            fill.cnt = 0;
+            if(  comp_on  )
+            { // Store the portions of the scan lines that are inside the path
+                // Compositor plane is output pixels (HiDPI) : scale window to output
+                int w, h; SDL_GetRendererOutputSize(ren, &w, &h);
+                float sx = (float)w/wI.w; float sy = (float)h/wI.h;
+                aff_path_clear(&comp_path); aff_path_append(&comp_path, &clip);
+                for( int i=0; i<comp_path.pt_cnt; i++ )
+                {
+                    comp_path.pts[i].x *= sx; comp_path.pts[i].y *= sy;
+                }
+                int row0 = (int)floorf(topmost.y*sy); if(row0<0) {row0=0;}  // Only visible rows
+                int row1 = (int)ceilf(botmost.y*sy); if(row1>h) {row1=h;}
+                aff_path_spans(&comp_path, fill_rule, row0, row1, &fill);
+                if(  fill.cnt > span_cap  )
+                {
+                    span_cap = fill.cnt;
+                    spans = realloc(spans, sizeof(CompSpan)*span_cap);
+                }
+                for( int i=0; i<fill.cnt; i++ )                 // Pixel centers in [x0, x1)
+                {
+                    AffSpan f = fill.s[i];
+                    spans[span_cnt++] = (CompSpan){f.y, (int)ceilf(f.x0-0.5), (int)ceilf(f.x1-0.5)};
+                }
+            }
+            else
+            { // Draw the portions of the scan lines that are inside the path
+                int row0 = (int)floorf(topmost.y); if(row0<0) {row0=0;}     // Only visible rows
+                int row1 = (int)ceilf(botmost.y); if(row1>wI.h) {row1=wI.h;}
+                aff_path_spans(&clip, fill_rule, row0, row1, &fill);
+                SDL_SetRenderDrawColor(ren, 200, 200, 10, 100); // Set fill color
+                for( int i=0; i<fill.cnt; i++ )
+                {
+                    SDL_RenderDrawLineF(ren, fill.s[i].x0, fill.s[i].y, fill.s[i].x1, fill.s[i].y);
+                }
+            }
+        }
+        if(  comp_on  ) // CPU compositor : one pass, one upload
+        TRACE_BLOCK("Composite")
+        { // Composite Grey Bgnd, polygon fill, and TV Static
+            int w, h; SDL_GetRendererOutputSize(ren, &w, &h);
+            if(  (w != comp_w) || (h != comp_h)  )              // Only on change
+            {
+                comp_w = w; comp_h = h;
+                if(  comp_tex  ) SDL_DestroyTexture(comp_tex);
+                comp_tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+                                             SDL_TEXTUREACCESS_STREAMING, w, h);
+                comp_plane = realloc(comp_plane, (size_t)w*h);
+            }
+            int count = 5000.0/(800*600)*w*h;                   // Same density as tv-static
+            SDL_FPoint *tv_noise = malloc(sizeof(SDL_FPoint)*count);
+            int *tv_alpha = malloc(sizeof(int)*count);
+            noise_fill_points(tv_noise, tv_alpha, 0, count, w, h, frame_cnt, 0, tv_max);
+            comp_scatter_points(comp_plane, w, h, tv_noise, tv_alpha, count);
+            free(tv_noise); free(tv_alpha);
+            Uint32 *px; int pitch;
+            SDL_LockTexture(comp_tex, NULL, (void **)&px, &pitch);    // Write straight to texture
+            comp_frame(px, pitch/4, w, h, comp_argb(10, 10, 10, 255),
+                       spans, span_cnt, comp_argb(200, 200, 10, 100), comp_plane);
+            SDL_UnlockTexture(comp_tex);
+            SDL_RenderCopy(ren, comp_tex, NULL, NULL);
+        }
+        TRACE_BLOCK("Draw Polygon")
+        { // Draw Polygon : outline each contour
             SDL_SetRenderDrawColor(ren, 255, 100, 10, 255);      // Alpha doesn't matter here
-            SDL_RenderDrawLinesF(ren, poly, poly_cnt);
-            /* free(poly);                                         // Free mem for polygon */
+            for( int c=0; c<clip.contour_cnt; c++ )
+            {
+                int start = aff_path_start(&clip, c);
+                SDL_RenderDrawLinesF(ren, clip.pts+start, clip.ends[c]-start);
+            }
         }
         { // Highlight top-most point
             SDL_SetRenderDrawColor(ren, 255, 0, 0, 200);
@@ -205,83 +439,8 @@ int main(int argc, char *argv[])
             SDL_FRect highlight = {.x=botmost.x-s, .y=botmost.y-s, .w=s*2, .h=s*2};
             SDL_RenderDrawRectF(ren, &highlight);
         }
-        if(1) // scanline : fill polygon (TODO: find intersections)
-        { // Fill the polygon
-            /* int y=topmost.y;                                    // Scan-line method */
-            float y=topmost.y;                                    // Scan-line method
-            SDL_SetRenderDrawColor(ren, 200, 100, 10, 180);     // Set fill color
-            // Make a list of lines out of the polygon sides
-            AffLine sides[poly_cnt-1];
-            for( int i=0; i<(poly_cnt-1); i++ )
-            {
-                sides[i] = aff_join_of_points(poly[i], poly[i+1]);
-            }
-            while(  y<botmost.y  )
-            {
-                AffLine scanline = {0, 1, y};                   // Line : y = constant
-                // Find intersection of scanline with each side
-                int meet_cnt = 0;                               // Count intersections
-                AffPoint meets[poly_cnt];                       // At most 1 meet per poly seg
-                for( int i=0; i<(poly_cnt-1); i++ )
-                {
-                    AffPoint meet = aff_meet_of_lines(scanline, sides[i]);
-                    // DEBUG: does this fix bugs where fill line is dropped?
-                    // Nope, makes it worse!
-                    /* meet.x = (int)meet.x; meet.y = (int)meet.y; */
-
-                    // Draw the portions of the scan line that are inside the polygon
-                    // Vector u : from a vertex on this side to the meet
-                    AffVec u = aff_vec_from_points(poly[i], meet);
-                    // Vector v : the two vertices that defined this side
-                    AffVec v = aff_vec_from_points(poly[i], poly[i+1]);
-                    bool float_error = true;
-                    float lambda;                               // scaling factor btwn u and v
-                    { // Lambda is just a ratio, but floating point error makes this tricky.
-                        // Get this wrong and every once in a while a line is dropped or doubled.
-                        /* if(  u.y != 0  ){ lambda = u.y / v.y; } */
-                        /* else            { lambda = u.x / v.x; } */
-                        float epsilon = 0.01;                       // Floating point error
-                        if(  u.x != 0  )     // Use vec.x if non-zero
-                        {
-                            lambda = u.x / v.x;
-                            if(  (v.x > epsilon) || (v.x < -1*epsilon) ) {float_error = false;}
-                        }
-                        else     // Use vec.y if vec.x is 0
-                        {
-                            lambda = u.y / v.y;
-                            if(  (v.y > epsilon) || (v.y < -1*epsilon) ) {float_error = false;}
-                        }
-                    }
-                    // TODO:
-                    // I don't want both lambda=0 and lambda=1, pick one.
-                    // The reason is I get two fill lines at the same y-value.
-                    // If the color has alpha, then the two lines overlap and it
-                    // doesn't look good.
-                    // TODO:
-                    // The calculation of the meet is *slightly* off. Why?
-                    // This causes the occasional fill line to get dropped.
-                    if(  float_error == false  )
-                    {
-                        if(  (lambda>0) && (lambda<=1)  )          // The meet is on the poly seg
-                        {
-                            meets[meet_cnt] = meet;                 // Store this meet
-                            meet_cnt++;                             // Track number of meets
-                        }
-                    }
-                }
-                { // Draw the portions of the scan line that are inside the polygon
-                    for( int i=0; i<meet_cnt-1; i++ )
-                    {
-                        // TODO: add an even/odd check on i to catch polygon cutouts
-                        SDL_SetRenderDrawColor(ren, 200, 200, 10, 100);     // Set fill color
-                        // Very important: do not use meets[i+1].y
-                        SDL_RenderDrawLineF(ren, meets[i].x, meets[i].y, meets[i+1].x, meets[i].y);
-                    }
-                }
-                y++;                                            // Advance scanline
-            }
-        }
         if(1) // DEBUG : stepping line to test my intersection algorithm
+        TRACE_BLOCK("DEBUG scanline")
         { // scanline : Step line up down with arrow keys instead of looping
             // Find intersection of scanline with each side
             // Make a list of lines out of the polygon sides
@@ -358,16 +517,23 @@ int main(int argc, char *argv[])
             }
 
         }
-        
-        free(poly);                                         // Free mem for polygon
+
+        TRACE_BLOCK("Display to screen")
         { // Display to screen
             SDL_RenderPresent(ren);
+            LatencyInfo_presented(&lI, seq, fill_look(&fill));  // Input is on screen
             SDL_Delay(10);
         }
+        frame_cnt++;
+        if(  frame_limit && (frame_cnt >= frame_limit)  ) quit = true; // Headless run is done
     }
 
     // Shutdown
+    bool latency_ok = LatencyInfo_report(&lI);
+    TRACE_DUMP();
+    free(spans); free(comp_plane);
+    aff_path_free(&path); aff_path_free(&clip); aff_path_free(&comp_path); free(fill.s);
     shutdown();
-    return EXIT_SUCCESS;
+    return latency_ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
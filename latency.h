@@ -0,0 +1,189 @@
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+/* *************DOC***************
+ * Input-to-photon latency.
+ *
+ * Every input event is stamped by SDL when it is queued (e.timestamp, ms).
+ * The game loop polls it, updates state, renders, and presents. The time
+ * from the event stamp to SDL_RenderPresent returning, for the first frame
+ * made with the updated state, is the latency.
+ *
+ * Only key presses that change the settings count: the key handler calls
+ * LatencyInfo_input() once it has changed something. Key releases, keys
+ * with no effect, and repeats that hit a limit have no frame to wait for.
+ *
+ *      queued  --(wait in queue)-->  polled  --(frame work)-->  presented
+ *      e.timestamp (SDL ticks, ms)   ticks + perf counter       perf counter
+ *
+ * That frame need not be the next one presented: a generator thread may
+ * have frames made with old settings in flight. So settings carry a
+ * sequence number. LatencyInfo_publish() counts each time the program
+ * applies its settings; an input polled before publish k is in frames made
+ * from settings k on. Each frame carries the sequence number it was made
+ * with, and LatencyInfo_presented() only counts the inputs it includes.
+ *
+ * The queue wait only has ms resolution (SDL timestamps are ms). The frame
+ * work is timed with the high-resolution counter.
+ *
+ * Environment:
+ *      TV_LATENCY=1        : record latency, print a histogram on exit
+ *      TV_SYNTH_KEYS=n     : push a synthetic key press every n frames
+ *                            (for headless runs: SDL_VIDEODRIVER=dummy)
+ *
+ * The synthetic key is one the program's polled key switch handles with a
+ * visible change. Each frame also carries a "look": a hash of what it
+ * shows. A key press whose frame looks the same as the frame before it
+ * changed nothing. The report counts those, and fails a synthetic run
+ * with any: it would be timing no-op events.
+ * *******************************/
+/* *************Example***************
+ *      LatencyInfo lI; LatencyInfo_setup(&lI, SDLK_TAB);       // TAB : next art
+ *      while(  quit == false  )
+ *      {
+ *          LatencyInfo_synth(&lI, frame_cnt);
+ *          while(  SDL_PollEvent(&e)  )
+ *          {
+ *              ... if(  key changed a setting  ) LatencyInfo_input(&lI, &e);
+ *          }
+ *          Uint32 seq = LatencyInfo_publish(&lI);              // Settings applied
+ *          ... make the frame from the settings, frame.seq = seq ...
+ *          SDL_RenderPresent(ren);
+ *          LatencyInfo_presented(&lI, frame.seq, frame.look);
+ *      }
+ *      bool ok = LatencyInfo_report(&lI);
+ * *******************************/
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LATENCY_PENDING_MAX 64                                  // Inputs in flight
+#define LATENCY_BUCKETS     100                                 // 1 ms each, last is overflow
+
+typedef struct
+{
+    bool on;                                                    // TV_LATENCY
+    int synth_every;                                            // TV_SYNTH_KEYS, 0 : off
+    SDL_Keycode synth_key;                                      // Key with a visible change
+    Uint32 seq;                                                 // Settings published
+    // Inputs polled, waiting for a frame that includes them
+    int pending_cnt;
+    double pending_us[LATENCY_PENDING_MAX];                     // Queue wait so far
+    Uint64 pending_poll[LATENCY_PENDING_MAX];                   // Perf counter at poll
+    Uint32 pending_seq[LATENCY_PENDING_MAX];                    // First settings with the input
+    // Results
+    Uint64 hist[LATENCY_BUCKETS];
+    Uint64 cnt;
+    double sum_us, max_us;
+    Uint64 look; bool looked;                                   // Last frame presented
+    Uint64 presses, noops;                                      // Key presses, w no change
+} LatencyInfo;
+
+void LatencyInfo_setup(LatencyInfo *lI, SDL_Keycode synth_key)
+{ // Read TV_LATENCY and TV_SYNTH_KEYS
+    SDL_zero(*lI);
+    lI->synth_key = synth_key;
+    lI->on = getenv("TV_LATENCY") && atoi(getenv("TV_LATENCY"));
+    lI->synth_every = getenv("TV_SYNTH_KEYS") ? atoi(getenv("TV_SYNTH_KEYS")) : 0;
+    if(  lI->synth_every > 0  ) lI->on = true;                  // Synthetic keys imply recording
+}
+
+void LatencyInfo_input(LatencyInfo *lI, const SDL_Event *e)
+{ // Call for a key press that changed the settings
+    if(  !lI->on || (e->type != SDL_KEYDOWN)  ) return;
+    if(  lI->pending_cnt == LATENCY_PENDING_MAX  ) return;     // Drop, frame is flooded
+    Uint32 now = SDL_GetTicks();
+    Uint32 wait = now - e->common.timestamp;                    // ms in the queue
+    lI->pending_us[lI->pending_cnt] = 1000.0*wait;
+    lI->pending_poll[lI->pending_cnt] = SDL_GetPerformanceCounter();
+    lI->pending_seq[lI->pending_cnt] = lI->seq + 1;             // In the next settings
+    lI->pending_cnt++;
+}
+
+Uint32 LatencyInfo_publish(LatencyInfo *lI)
+{ // Call when the program applies its settings. Return their sequence number.
+    return ++lI->seq;
+}
+
+void LatencyInfo_presented(LatencyInfo *lI, Uint32 seq, Uint64 look)
+{ // Call right after SDL_RenderPresent returns, w the frame's settings seq and look
+    if(  !lI->on  ) return;
+    Uint64 now = SDL_GetPerformanceCounter();
+    double us_per_tick = 1e6/SDL_GetPerformanceFrequency();
+    int kept = 0; int presses = 0;
+    for( int i=0; i<lI->pending_cnt; i++ )
+    {
+        if(  (Sint32)(lI->pending_seq[i] - seq) > 0  )          // Not in this frame yet
+        {
+            lI->pending_us[kept] = lI->pending_us[i];
+            lI->pending_poll[kept] = lI->pending_poll[i];
+            lI->pending_seq[kept] = lI->pending_seq[i];
+            kept++;
+            continue;
+        }
+        double us = lI->pending_us[i] + (now - lI->pending_poll[i])*us_per_tick;
+        int b = (int)(us/1000); if(b >= LATENCY_BUCKETS) {b = LATENCY_BUCKETS-1;}
+        lI->hist[b]++;
+        lI->cnt++;
+        lI->sum_us += us;
+        if(  us > lI->max_us  ) lI->max_us = us;
+        presses++;
+    }
+    lI->pending_cnt = kept;
+    lI->presses += presses;
+    if(  presses && lI->looked && (look == lI->look)  ) lI->noops += presses;
+    lI->look = look; lI->looked = true;
+}
+
+void LatencyInfo_synth(LatencyInfo *lI, int frame_cnt)
+{ // Push a synthetic key press (and release) every synth_every frames
+    if(  (lI->synth_every <= 0) || (frame_cnt % lI->synth_every)  ) return;
+    SDL_Event e; SDL_zero(e);
+    e.type = SDL_KEYDOWN;
+    e.key.timestamp = SDL_GetTicks();
+    e.key.state = SDL_PRESSED;
+    e.key.keysym.scancode = SDL_GetScancodeFromKey(lI->synth_key);
+    e.key.keysym.sym = lI->synth_key;
+    SDL_PushEvent(&e);
+    e.type = SDL_KEYUP; e.key.state = SDL_RELEASED;
+    SDL_PushEvent(&e);
+}
+
+int LatencyInfo_percentile(LatencyInfo *lI, double p)
+{ // Upper edge (ms) of the bucket holding the p-th percentile
+    Uint64 want = (Uint64)(p*lI->cnt + 0.999999); if(want<1) {want=1;}
+    Uint64 seen = 0;
+    for( int b=0; b<LATENCY_BUCKETS; b++ )
+    {
+        seen += lI->hist[b];
+        if(  seen >= want  ) return b+1;
+    }
+    return LATENCY_BUCKETS;
+}
+
+bool LatencyInfo_report(LatencyInfo *lI)
+{ // Print summary and histogram to stdout. False : synthetic presses changed nothing.
+    if(  !lI->on  ) return true;
+    printf("\n# Input-to-photon latency: %llu events\n", (unsigned long long)lI->cnt);
+    bool ok = !((lI->synth_every > 0) && (lI->noops > 0));
+    if(  lI->noops  ) printf("%llu of %llu key presses changed nothing on screen%s\n",
+                             (unsigned long long)lI->noops, (unsigned long long)lI->presses,
+                             ok ? "" : " (synthetic key is a no-op)");
+    if(  lI->cnt == 0  ) return ok;
+    printf("mean %.2f ms, max %.2f ms, p50 <%d ms, p90 <%d ms, p99 <%d ms\n",
+            lI->sum_us/lI->cnt/1000, lI->max_us/1000,
+            LatencyInfo_percentile(lI, 0.50), LatencyInfo_percentile(lI, 0.90),
+            LatencyInfo_percentile(lI, 0.99));
+    Uint64 most = 0;
+    for( int b=0; b<LATENCY_BUCKETS; b++ ) { if(lI->hist[b] > most) {most = lI->hist[b];} }
+    for( int b=0; b<LATENCY_BUCKETS; b++ )
+    {
+        if(  lI->hist[b] == 0  ) continue;
+        int bar = (int)(40*lI->hist[b]/most);
+        printf("%3d%s ms |", b, (b == LATENCY_BUCKETS-1) ? "+" : " ");
+        for( int i=0; i<bar; i++ ) putchar('#');
+        printf(" %llu\n", (unsigned long long)lI->hist[b]);
+    }
+    return ok;
+}
+
+#endif // __LATENCY_H__
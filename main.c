@@ -92,6 +92,8 @@ int main(int argc, char *argv[])
 
     // Game state
     bool quit = false;
+    int frame_limit = getenv("TV_FRAMES") ? atoi(getenv("TV_FRAMES")) : 0; // 0 : run until Esc
+    int frame_cnt = 0;                                          // Frames presented
     // Game loop
     while(  quit == false  )
     {
@@ -364,6 +366,8 @@ int main(int argc, char *argv[])
             SDL_RenderPresent(ren);
             SDL_Delay(10);
         }
+        frame_cnt++;
+        if(  frame_limit && (frame_cnt >= frame_limit)  ) quit = true; // Headless run is done
     }
 
     // Shutdown
@@ -0,0 +1,109 @@
+#ifndef __NOISE_H__
+#define __NOISE_H__
+/* *************DOC***************
+ * Stateless, counter-based noise.
+ *
+ * rand() is a stream: value n depends on values 0..n-1, so noise must be
+ * generated in order, on one thread, and replayed from the start to
+ * reproduce a frame.
+ *
+ * noise_hash() instead computes each value directly from its coordinates:
+ *
+ *      value = hash(x, y, frame, seed)
+ *
+ * Any pixel, strip, or tile can be generated on its own, in any order, on
+ * any thread, and the same (x, y, frame, seed) always gives the same value.
+ *
+ * The hash is squirrel-style: a few 32-bit multiplies, adds, xors and
+ * shifts. No branches, no tables, no state, so the bulk-fill loops below
+ * auto-vectorize (8 lanes with -mavx2, 4 with -msse4.1).
+ * *******************************/
+/* *************Example***************
+ * Alpha for one pixel:
+ *
+ *      int a = noise_alpha(x, y, frame, seed, tv_max);
+ *
+ * Fill n points (positions and alpha) for this frame:
+ *
+ *      noise_fill_points(tv_noise, tv_alpha, 0, n, w, h, frame, seed, tv_max);
+ *
+ * Fill points [i0, i0+n) only (e.g., one thread's share of the work):
+ *
+ *      noise_fill_points(tv_noise+i0, tv_alpha+i0, i0, n, w, h, frame, seed, tv_max);
+ * *******************************/
+#include <stdint.h>
+
+#define NOISE_PRIME_Y       198491317u                          // Large primes with
+#define NOISE_PRIME_FRAME   6542989u                            // non-boring bits
+#define NOISE_SEED_Y        0x9E3779B9u                         // Seed offset: y channel
+
+uint32_t noise_hash(uint32_t n, uint32_t seed)
+{ // Squirrel-style integer hash of n
+    n *= 0xB5297A4Du;
+    n += seed;
+    n ^= (n >> 8);
+    n += 0x68E31DA4u;
+    n ^= (n << 8);
+    n *= 0x1B56C4E9u;
+    n ^= (n >> 8);
+    return n;
+}
+
+uint32_t noise_hash_xyf(uint32_t x, uint32_t y, uint32_t frame, uint32_t seed)
+{ // Hash of pixel (x,y) at this frame
+    return noise_hash(x + NOISE_PRIME_Y*y + NOISE_PRIME_FRAME*frame, seed);
+}
+
+int noise_alpha(int x, int y, uint32_t frame, uint32_t seed, int max)
+{
+    /* *************DOC***************
+     * Return alpha in range 0 to max for pixel (x,y) at this frame.
+     *
+     * Top 24 bits of the hash scaled by (max+1): no division, and no
+     * bias worth worrying about at 8-bit alpha. max must be <= 255.
+     * *******************************/
+    uint32_t h = noise_hash_xyf(x, y, frame, seed) >> 8;
+    return (int)((h*(uint32_t)(max+1)) >> 24);                  // h*(max+1) < 2^32
+}
+
+void noise_fill_alpha_row(uint8_t *alpha, int x0, int n, int y, uint32_t frame, uint32_t seed, int max)
+{ // alpha[i] = noise_alpha(x0+i, y, frame, seed, max) for i in [0, n)
+    uint32_t base = NOISE_PRIME_Y*(uint32_t)y + NOISE_PRIME_FRAME*frame;
+    uint32_t m = max+1;
+    for(int i=0; i<n; i++)
+    {
+        uint32_t h = noise_hash(base + (uint32_t)(x0+i), seed) >> 8;
+        alpha[i] = (uint8_t)((h*m) >> 24);                      // h*m fits in 32 bits
+    }
+}
+
+void noise_fill_points(SDL_FPoint *pts, int *alpha, int i0, int n, int w, int h,
+                       uint32_t frame, uint32_t seed, int max)
+{
+    /* *************DOC***************
+     * Fill points i0 to i0+n-1 of this frame's static.
+     *
+     * Point i lands at a position hashed from (i, frame, seed).
+     * Its alpha is hashed from the pixel it lands on: (x, y, frame, seed).
+     *
+     * Writes pts[0..n-1] and alpha[0..n-1].
+     * *******************************/
+    uint32_t f = NOISE_PRIME_FRAME*frame;
+    uint32_t m = max+1;
+    float sx = (float)w/16777216.0f;                            // 24-bit hash to [0,w)
+    float sy = (float)h/16777216.0f;                            // 24-bit hash to [0,h)
+    for(int k=0; k<n; k++)
+    {
+        uint32_t i = (uint32_t)(i0+k);
+        uint32_t hx = noise_hash(i + f, seed) >> 8;
+        uint32_t hy = noise_hash(i + f, seed + NOISE_SEED_Y) >> 8;
+        pts[k].x = (float)hx*sx;
+        pts[k].y = (float)hy*sy;
+        uint32_t px = (uint32_t)pts[k].x;                       // Pixel x
+        uint32_t py = (uint32_t)pts[k].y;                       // Pixel y
+        uint32_t ha = noise_hash(px + NOISE_PRIME_Y*py + f, seed) >> 8;
+        alpha[k] = (int)((ha*m) >> 24);
+    }
+}
+
+#endif // __NOISE_H__
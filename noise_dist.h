@@ -0,0 +1,358 @@
+#ifndef __NOISE_DIST_H__
+#define __NOISE_DIST_H__
+/* *************DOC***************
+ * Non-uniform static: Gaussian, exponential, or histogram brightness,
+ * and optionally clustered grain.
+ *
+ * noise.h draws alpha uniformly in 0..max. Analog static is mostly mid
+ * grey with few extremes (Gaussian), or mostly dim with rare bright
+ * sparks (exponential), or whatever a histogram says. Sampling those
+ * with exp/log/sqrt per point costs several times the uniform hash.
+ *
+ * Instead, tables are built once at startup and each sample is one hash
+ * plus a table lookup and a compare:
+ *
+ *      Gaussian, exponential   : ziggurat (Marsaglia & Tsang 2000),
+ *                                128 / 256 layers. About 1 sample in 50
+ *                                misses the fast path and pays for an
+ *                                exp or log.
+ *      histogram               : alias method (Vose), up to 256 bins.
+ *                                Always one lookup, no misses.
+ *
+ * Samples stay counter-based: a sample is hashed from a key (the pixel
+ * and frame, as in noise.h), and a miss re-hashes the key, so any point
+ * can still be made on its own, on any thread.
+ *
+ * Clustered grain: points come in clumps of "cluster" points, each clump
+ * spread around a hashed center with a Gaussian of cluster_r pixels.
+ * *******************************/
+/* *************Example***************
+ *      NoiseDist d; noise_dist_init(&d, NOISE_DIST_GAUSS);     // Once
+ *      noise_dist_fill_points(&d, pts, alpha, 0, n, w, h, frame, seed, max);
+ *
+ *      float weights[] = {8, 4, 2, 1, 1, 1, 2, 3};             // Histogram
+ *      noise_dist_set_hist(&d, weights, 8);
+ * *******************************/
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "noise.h"
+
+#define NOISE_PRIME_RETRY   0x2C1B3C6Du                         // Key step for a ziggurat miss
+#define NOISE_SEED_CLUSTER  0x7F4A7C15u                         // Seed offset: cluster spread
+#define NOISE_HIST_MAX      256                                 // Histogram bins
+#define NOISE_DIST_BLOCK    1024                                // Points per fill pass
+
+typedef enum
+{
+    NOISE_DIST_UNIFORM,                                         // Same as noise.h
+    NOISE_DIST_GAUSS,                                           // Mean max/2, sigma max/6
+    NOISE_DIST_EXP,                                             // Mean max/4
+    NOISE_DIST_HIST,                                            // Bin b : alpha b*max/(n-1)
+    NOISE_DIST_COUNT
+} NoiseDistKind;
+
+typedef struct
+{
+    NoiseDistKind kind;
+    int cluster;                                                // Points per clump, <2 : none
+    float cluster_r;                                            // Clump spread (px)
+    // Ziggurat: normal
+    uint32_t kn[128]; float wn[128]; float fn[128];
+    // Ziggurat: exponential
+    uint32_t ke[256]; float we[256]; float fe[256];
+    // Alias method: histogram
+    int hist_n;
+    uint64_t hist_step;                                         // 2^32/(hist_n-1), rounded up
+    uint16_t hist_prob[NOISE_HIST_MAX];                         // Keep bin if coin < prob
+    uint8_t hist_alias[NOISE_HIST_MAX];                         // Else take this bin
+} NoiseDist;
+
+const char *noise_dist_name(NoiseDistKind kind)
+{
+    switch(  kind  )
+    {
+        case NOISE_DIST_GAUSS:  return "gauss";
+        case NOISE_DIST_EXP:    return "exp";
+        case NOISE_DIST_HIST:   return "hist";
+        default:                return "uniform";
+    }
+}
+
+NoiseDistKind noise_dist_kind(const char *name)
+{ // "gauss" -> NOISE_DIST_GAUSS, unknown names are uniform
+    for( int k=0; k<NOISE_DIST_COUNT; k++ )
+    {
+        if(  strcmp(name, noise_dist_name(k)) == 0  ) return k;
+    }
+    return NOISE_DIST_UNIFORM;
+}
+
+bool noise_dist_set_hist(NoiseDist *d, const float *weights, int n)
+{
+    /* *************DOC***************
+     * Build the alias table for n bins (2 <= n <= 256) with these weights.
+     * Sets kind to NOISE_DIST_HIST. False (and no change) if the weights
+     * are unusable.
+     * *******************************/
+    if(  (n < 2) || (n > NOISE_HIST_MAX)  ) return false;
+    double sum = 0;
+    for( int i=0; i<n; i++ ) { if(weights[i] < 0) {return false;} sum += weights[i]; }
+    if(  sum <= 0  ) return false;
+    double p[NOISE_HIST_MAX]; int small[NOISE_HIST_MAX]; int large[NOISE_HIST_MAX];
+    int ns = 0; int nl = 0;
+    for( int i=0; i<n; i++ )
+    {
+        p[i] = weights[i]*n/sum;                                // Mean 1
+        if(  p[i] < 1  ) small[ns++] = i; else large[nl++] = i;
+    }
+    while(  (ns > 0) && (nl > 0)  )                             // Vose: fill each small bin
+    {                                                           // up to 1 from a large one
+        int s = small[--ns]; int l = large[--nl];
+        d->hist_prob[s] = (uint16_t)(p[s]*65535);
+        d->hist_alias[s] = (uint8_t)l;
+        p[l] -= 1 - p[s];
+        if(  p[l] < 1  ) small[ns++] = l; else large[nl++] = l;
+    }
+    while(  nl > 0  ) { int l = large[--nl]; d->hist_prob[l] = 65535; d->hist_alias[l] = (uint8_t)l; }
+    while(  ns > 0  ) { int s = small[--ns]; d->hist_prob[s] = 65535; d->hist_alias[s] = (uint8_t)s; }
+    d->hist_n = n;
+    d->hist_step = ((1ull << 32) + n-2)/(n-1);                  // Up : exact b*max/(n-1) below 2^16
+    d->kind = NOISE_DIST_HIST;
+    return true;
+}
+
+bool noise_dist_parse_hist(NoiseDist *d, const char *s)
+{ // Histogram from comma separated weights: "8,4,2,1,1,1,2,3"
+    float w[NOISE_HIST_MAX]; int n = 0;
+    char *end;
+    while(  n < NOISE_HIST_MAX  )
+    {
+        w[n] = strtof(s, &end);
+        if(  end == s  ) break;
+        n++;
+        s = end; if(*s == ',') {s++;}
+    }
+    return noise_dist_set_hist(d, w, n);
+}
+
+void noise_dist_init(NoiseDist *d, NoiseDistKind kind)
+{ // Build the ziggurat tables and a default histogram. Call once.
+    double m1 = 2147483648.0; double m2 = 4294967296.0;
+    { // Normal, 128 layers
+        double dn = 3.442619855899; double tn = dn; double vn = 9.91256303526217e-3;
+        double q = vn/exp(-0.5*dn*dn);
+        d->kn[0] = (uint32_t)((dn/q)*m1); d->kn[1] = 0;
+        d->wn[0] = q/m1; d->wn[127] = dn/m1;
+        d->fn[0] = 1; d->fn[127] = exp(-0.5*dn*dn);
+        for( int i=126; i>=1; i-- )
+        {
+            dn = sqrt(-2*log(vn/dn + exp(-0.5*dn*dn)));
+            d->kn[i+1] = (uint32_t)((dn/tn)*m1); tn = dn;
+            d->fn[i] = exp(-0.5*dn*dn); d->wn[i] = dn/m1;
+        }
+    }
+    { // Exponential, 256 layers
+        double de = 7.697117470131487; double te = de; double ve = 3.949659822581572e-3;
+        double q = ve/exp(-de);
+        d->ke[0] = (uint32_t)((de/q)*m2); d->ke[1] = 0;
+        d->we[0] = q/m2; d->we[255] = de/m2;
+        d->fe[0] = 1; d->fe[255] = exp(-de);
+        for( int i=254; i>=1; i-- )
+        {
+            de = -log(ve/de + exp(-de));
+            d->ke[i+1] = (uint32_t)((de/te)*m2); te = de;
+            d->fe[i] = exp(-de); d->we[i] = de/m2;
+        }
+    }
+    float grain[] = {8, 4, 2, 1, 1, 1, 2, 3};                   // Mostly dark, some bright
+    noise_dist_set_hist(d, grain, 8);
+    d->kind = kind;
+    d->cluster = 0; d->cluster_r = 2;
+}
+
+float noise_dist_unit(uint32_t u)
+{ // Top 24 bits of u to (0, 1]
+    return ((u >> 8) + 1) * (1.0f/16777216.0f);
+}
+
+float noise_dist_normal(const NoiseDist *d, uint32_t key, uint32_t seed)
+{ // Standard normal sample for key
+    uint32_t u = noise_hash(key, seed);
+    for( uint32_t k=1; ; k++ )
+    {
+        int32_t hz = (int32_t)u; int iz = hz & 127;
+        uint32_t az = hz < 0 ? 0u - (uint32_t)hz : (uint32_t)hz;
+        if(  az < d->kn[iz]  ) return hz*d->wn[iz];             // Fast path: inside the layer
+        float x;
+        uint32_t u1 = noise_hash(key + k*NOISE_PRIME_RETRY, seed + 1);
+        if(  iz == 0  )                                         // Base layer: the tail
+        {
+            const float r = 3.442620f;
+            float y;
+            do
+            {
+                x = -logf(noise_dist_unit(u1))/r;
+                y = -logf(noise_dist_unit(noise_hash(u1, seed + 2)));
+                u1 = noise_hash(u1, seed + 3);
+            } while(  y+y < x*x  );
+            return hz > 0 ? r+x : -r-x;
+        }
+        x = hz*d->wn[iz];                                       // Wedge
+        if(  d->fn[iz] + noise_dist_unit(u1)*(d->fn[iz-1] - d->fn[iz]) < expf(-0.5f*x*x)  ) return x;
+        u = noise_hash(key + k*NOISE_PRIME_RETRY, seed);        // Miss : next sample
+    }
+}
+
+float noise_dist_exp(const NoiseDist *d, uint32_t key, uint32_t seed)
+{ // Standard exponential sample (mean 1) for key
+    uint32_t u = noise_hash(key, seed);
+    for( uint32_t k=1; ; k++ )
+    {
+        int iz = u & 255;
+        if(  u < d->ke[iz]  ) return u*d->we[iz];               // Fast path: inside the layer
+        uint32_t u1 = noise_hash(key + k*NOISE_PRIME_RETRY, seed + 1);
+        if(  iz == 0  ) return 7.697117f - logf(noise_dist_unit(u1));   // Tail
+        float x = u*d->we[iz];                                  // Wedge
+        if(  d->fe[iz] + noise_dist_unit(u1)*(d->fe[iz-1] - d->fe[iz]) < expf(-x)  ) return x;
+        u = noise_hash(key + k*NOISE_PRIME_RETRY, seed);        // Miss : next sample
+    }
+}
+
+int noise_dist_hist_bin(const NoiseDist *d, uint32_t key, uint32_t seed)
+{ // Histogram bin for key: top 16 bits pick a bin, low 16 bits flip its coin
+    uint32_t u = noise_hash(key, seed);
+    int b = (int)(((u >> 16)*(uint32_t)d->hist_n) >> 16);
+    int keep = -(int)((u & 0xFFFF) < d->hist_prob[b]);          // Branchless: the coin is
+    return (b & keep) | (d->hist_alias[b] & ~keep);             // a coin, it mispredicts
+}
+
+int noise_dist_clamp(float a, int max)
+{ // Round a to an alpha in 0..max
+    a += 0.5f;
+    return a < 0 ? 0 : (a > max ? max : (int)a);
+}
+
+int noise_dist_alpha(const NoiseDist *d, uint32_t key, uint32_t seed, int max)
+{ // Alpha in 0..max for key, shaped by d->kind
+    switch(  d->kind  )
+    {
+        case NOISE_DIST_GAUSS: return noise_dist_clamp(max*(0.5f + noise_dist_normal(d, key, seed)/6), max);
+        case NOISE_DIST_EXP:   return noise_dist_clamp(max*0.25f*noise_dist_exp(d, key, seed), max);
+        case NOISE_DIST_HIST:                                   // Fixed point, no divide, exact
+            return (int)(((uint64_t)noise_dist_hist_bin(d, key, seed)*max*d->hist_step) >> 32);
+        default:               return (int)(((noise_hash(key, seed) >> 8)*(uint32_t)(max+1)) >> 24);
+    }
+}
+
+void noise_dist_fill_alpha(const NoiseDist *d, const SDL_FPoint *pts, int *alpha, int n,
+                           uint32_t f, uint32_t seed, int max)
+{
+    /* *************DOC***************
+     * alpha[k] = noise_dist_alpha() of the pixel pts[k] is on.
+     *
+     * One loop per kind, no switch per point. The ziggurat loops only do
+     * the fast path (hash, layer lookup, compare) and mark a miss with -1,
+     * so they have no calls and no loop-carried retries. A second pass
+     * finishes the misses (about 1 in 50) with the full sampler: it hashes
+     * the same key, so the alpha is the same as sampling point by point.
+     * *******************************/
+    switch(  d->kind  )
+    {
+        case NOISE_DIST_GAUSS:
+            for( int k=0; k<n; k++ )
+            {
+                uint32_t key = (uint32_t)pts[k].x + NOISE_PRIME_Y*(uint32_t)pts[k].y + f;
+                int32_t hz = (int32_t)noise_hash(key, seed); int iz = hz & 127;
+                uint32_t az = hz < 0 ? 0u - (uint32_t)hz : (uint32_t)hz;
+                int a = noise_dist_clamp(max*(0.5f + hz*d->wn[iz]/6), max);
+                alpha[k] = (az < d->kn[iz]) ? a : -1;           // -1 : miss
+            }
+            break;
+        case NOISE_DIST_EXP:
+            for( int k=0; k<n; k++ )
+            {
+                uint32_t key = (uint32_t)pts[k].x + NOISE_PRIME_Y*(uint32_t)pts[k].y + f;
+                uint32_t u = noise_hash(key, seed); int iz = u & 255;
+                int a = noise_dist_clamp(max*0.25f*(u*d->we[iz]), max);
+                alpha[k] = (u < d->ke[iz]) ? a : -1;            // -1 : miss
+            }
+            break;
+        case NOISE_DIST_HIST:
+            for( int k=0; k<n; k++ )
+            {
+                uint32_t key = (uint32_t)pts[k].x + NOISE_PRIME_Y*(uint32_t)pts[k].y + f;
+                alpha[k] = (int)(((uint64_t)noise_dist_hist_bin(d, key, seed)*max*d->hist_step) >> 32);
+            }
+            return;                                             // No misses
+        default:
+        {
+            uint32_t m = max+1;
+            for( int k=0; k<n; k++ )
+            {
+                uint32_t key = (uint32_t)pts[k].x + NOISE_PRIME_Y*(uint32_t)pts[k].y + f;
+                alpha[k] = (int)(((noise_hash(key, seed) >> 8)*m) >> 24);
+            }
+            return;
+        }
+    }
+    for( int k=0; k<n; k++ )                                    // Misses : full sampler
+    {
+        if(  alpha[k] >= 0  ) continue;
+        uint32_t key = (uint32_t)pts[k].x + NOISE_PRIME_Y*(uint32_t)pts[k].y + f;
+        alpha[k] = noise_dist_alpha(d, key, seed, max);
+    }
+}
+
+void noise_dist_fill_points(const NoiseDist *d, SDL_FPoint *pts, int *alpha, int i0, int n,
+                            int w, int h, uint32_t frame, uint32_t seed, int max)
+{
+    /* *************DOC***************
+     * noise_fill_points() with alpha from d, and clumps if d->cluster > 1.
+     * Uniform without clumps is exactly noise_fill_points().
+     *
+     * Positions first, then noise_dist_fill_alpha() over them: each pass
+     * is one tight loop. Points go in blocks that stay in L1 between the
+     * two passes.
+     * *******************************/
+    if(  (d->kind == NOISE_DIST_UNIFORM) && (d->cluster < 2)  )
+    {
+        noise_fill_points(pts, alpha, i0, n, w, h, frame, seed, max);
+        return;
+    }
+    uint32_t f = NOISE_PRIME_FRAME*frame;
+    float sx = (float)w/16777216.0f;                            // 24-bit hash to [0,w)
+    float sy = (float)h/16777216.0f;                            // 24-bit hash to [0,h)
+    int per = d->cluster < 2 ? 1 : d->cluster;
+    for( int b=0; b<n; b+=NOISE_DIST_BLOCK )
+    {
+        int m = (n-b < NOISE_DIST_BLOCK) ? n-b : NOISE_DIST_BLOCK;
+        SDL_FPoint *p = pts + b;
+        if(  per == 1  )
+        { // Positions, no clumps : same as noise_fill_points()
+            for( int k=0; k<m; k++ )
+            {
+                uint32_t i = (uint32_t)(i0+b+k);
+                p[k].x = (float)(noise_hash(i + f, seed) >> 8)*sx;
+                p[k].y = (float)(noise_hash(i + f, seed + NOISE_SEED_Y) >> 8)*sy;
+            }
+        }
+        else for( int k=0; k<m; k++ )
+        { // Positions, spread around the clump center
+            uint32_t i = (uint32_t)(i0+b+k);
+            uint32_t c = i/per;                                 // Clump
+            float x = (float)(noise_hash(c + f, seed) >> 8)*sx;
+            float y = (float)(noise_hash(c + f, seed + NOISE_SEED_Y) >> 8)*sy;
+            x += d->cluster_r*noise_dist_normal(d, i + f, seed + NOISE_SEED_CLUSTER);
+            y += d->cluster_r*noise_dist_normal(d, i + f, seed + NOISE_SEED_CLUSTER + NOISE_SEED_Y);
+            if(x<0) {x=0;} if(x>=w) {x=w-1;}
+            if(y<0) {y=0;} if(y>=h) {y=h-1;}
+            p[k].x = x; p[k].y = y;
+        }
+        noise_dist_fill_alpha(d, p, alpha + b, m, f, seed, max);
+    }
+}
+
+#endif // __NOISE_DIST_H__
@@ -0,0 +1,239 @@
+#ifndef __NOISE_SHM_H__
+#define __NOISE_SHM_H__
+/* *************DOC***************
+ * Shared-memory TV static: one server, many overlay windows.
+ *
+ * Each tv-static overlay sits on a Vim window. Without sharing, every
+ * overlay generates its own static and CPU cost grows with the overlay
+ * count. Instead, one process serves static for the whole screen into a
+ * POSIX shared-memory ring, and each overlay copies out the part under
+ * its window. Generating is done once, however many overlays attach.
+ *
+ * Layout of the shared memory object NOISE_SHM_NAME:
+ *
+ *      NoiseShmHeader          : magic, plane rect, frame counter, seqs
+ *      plane 0 .. SLOTS-1      : w*h static alpha, one byte per pixel
+ *
+ * The server writes frame f into slot f % SLOTS, then counts it in
+ * "frame" (unsigned, wraps). A reader copies the newest slot. Each slot
+ * has a sequence number (seqlock): odd while the server writes the slot.
+ * A reader that sees it odd, or changed after the copy, copies again.
+ *
+ * A server that crashes leaves the object behind, magic and all. The
+ * header holds the server's pid: attach refuses a server that is gone.
+ *
+ * POSIX only. On Windows serve and attach fail and callers fall back to
+ * generating their own static.
+ * *******************************/
+/* *************Example***************
+ *      // Server
+ *      NoiseShm s; NoiseShm_serve(&s, screen_x, screen_y, screen_w, screen_h);
+ *      uint8_t *plane = NoiseShm_begin(&s); make_static(plane); NoiseShm_publish(&s);
+ *
+ *      // Overlay
+ *      NoiseShm s; int seen = -1;
+ *      if(  NoiseShm_attach(&s)  )
+ *          seen = NoiseShm_read(&s, seen, win_x, win_y, win_w, win_h, plane, plane_w, plane_h);
+ * *******************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+#define NOISE_SHM_NAME  "/tv-static-noise"
+#define NOISE_SHM_MAGIC 0x54565348u                             // "TVSH"
+#define NOISE_SHM_SLOTS 3                                       // Ring of planes
+#define NOISE_SHM_HDR   64                                      // Header bytes (one cache line)
+
+typedef struct
+{
+    Uint32 magic;                                               // NOISE_SHM_MAGIC : ready
+    int x, y, w, h;                                             // Plane rect, screen coordinates
+    int pid;                                                    // Server process
+    SDL_atomic_t frame;                                         // Frames published
+    SDL_atomic_t seq[NOISE_SHM_SLOTS];                          // Odd : slot being written
+} NoiseShmHeader;
+_Static_assert(sizeof(NoiseShmHeader) <= NOISE_SHM_HDR, "NoiseShmHeader must fit before the planes");
+
+typedef struct
+{
+    NoiseShmHeader *hdr;
+    uint8_t *planes;                                            // SLOTS planes of w*h
+    size_t size;                                                // Mapped bytes
+    bool server;                                                // Server unlinks on close
+} NoiseShm;
+
+size_t NoiseShm_size(int w, int h)
+{ // Bytes for header and planes
+    return NOISE_SHM_HDR + (size_t)NOISE_SHM_SLOTS*w*h;
+}
+
+#ifndef _WIN32
+void *NoiseShm_map(int fd, size_t size)
+{ // Map fd read/write (the seqs are atomics), NULL on failure
+    void *p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+}
+#endif
+
+bool NoiseShm_serve(NoiseShm *s, int x, int y, int w, int h)
+{ // Create the shared memory for a plane covering screen rect x,y,w,h. False : no sharing.
+    SDL_zero(*s);
+#ifndef _WIN32
+    shm_unlink(NOISE_SHM_NAME);                                 // Drop a dead server's object
+    int fd = shm_open(NOISE_SHM_NAME, O_CREAT|O_EXCL|O_RDWR, 0600);
+    if(  fd < 0  ) return false;
+    s->size = NoiseShm_size(w, h);
+    void *p = NULL;
+    if(  ftruncate(fd, s->size) == 0  ) p = NoiseShm_map(fd, s->size);
+    close(fd);                                                  // Mapping stays valid
+    if(  p == NULL  ) { shm_unlink(NOISE_SHM_NAME); return false; }
+    s->hdr = p; s->planes = (uint8_t *)p + NOISE_SHM_HDR;
+    s->server = true;
+    s->hdr->x = x; s->hdr->y = y;                               // ftruncate zeroed the rest
+    s->hdr->w = w; s->hdr->h = h;
+    s->hdr->pid = (int)getpid();
+    SDL_MemoryBarrierRelease();
+    s->hdr->magic = NOISE_SHM_MAGIC;                            // Readers may attach now
+    return true;
+#else
+    (void)x; (void)y; (void)w; (void)h;
+    return false;
+#endif
+}
+
+bool NoiseShm_alive(const NoiseShm *s)
+{ // True if the server process still exists
+#ifndef _WIN32
+    return (kill((pid_t)s->hdr->pid, 0) == 0) || (errno == EPERM);   // EPERM : exists, not ours
+#else
+    (void)s;
+    return false;
+#endif
+}
+
+bool NoiseShm_attach(NoiseShm *s)
+{ // Map the server's shared memory. False : no server, or it died.
+    SDL_zero(*s);
+#ifndef _WIN32
+    int fd = shm_open(NOISE_SHM_NAME, O_RDWR, 0600);
+    if(  fd < 0  ) return false;
+    struct stat st;
+    void *p = NULL;
+    if(  (fstat(fd, &st) == 0) && ((size_t)st.st_size > NOISE_SHM_HDR)  ) p = NoiseShm_map(fd, st.st_size);
+    close(fd);
+    if(  p == NULL  ) return false;
+    s->hdr = p; s->size = st.st_size;
+    Uint32 magic = s->hdr->magic;
+    SDL_MemoryBarrierAcquire();                                 // magic before rect (serve's release)
+    if(  (magic != NOISE_SHM_MAGIC) ||                          // Server not ready
+         (NoiseShm_size(s->hdr->w, s->hdr->h) != s->size) ||
+         !NoiseShm_alive(s)  )                                  // Crashed : object left behind
+    {
+        munmap(p, s->size); SDL_zero(*s); return false;
+    }
+    s->planes = (uint8_t *)p + NOISE_SHM_HDR;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void NoiseShm_close(NoiseShm *s)
+{
+#ifndef _WIN32
+    if(  s->hdr  ) munmap(s->hdr, s->size);
+    if(  s->server  ) shm_unlink(NOISE_SHM_NAME);
+#endif
+    SDL_zero(*s);
+}
+
+uint8_t *NoiseShm_begin(NoiseShm *s)
+{ // Server: the plane to write next frame into
+    int slot = (Uint32)SDL_AtomicGet(&s->hdr->frame) % NOISE_SHM_SLOTS;
+    SDL_AtomicAdd(&s->hdr->seq[slot], 1);                       // Odd : writing
+    return s->planes + (size_t)slot*s->hdr->w*s->hdr->h;
+}
+
+void NoiseShm_publish(NoiseShm *s)
+{ // Server: frame is complete
+    int slot = (Uint32)SDL_AtomicGet(&s->hdr->frame) % NOISE_SHM_SLOTS;
+    SDL_MemoryBarrierRelease();                                 // Plane writes before seq
+    SDL_AtomicAdd(&s->hdr->seq[slot], 1);                       // Even : done
+    SDL_AtomicAdd(&s->hdr->frame, 1);
+}
+
+void NoiseShm_copy_row(const uint8_t *plane, int pw, int py, int x, int w, uint8_t *d, int dw)
+{ // Sample plane row py from x to x+w into dw bytes (nearest). Off-plane is zero.
+    const uint8_t *row = plane + (size_t)py*pw;
+    if(  dw == w  )                                             // Same size : copy
+    {
+        int x0 = x < 0 ? 0 : x;   int x1 = x+w > pw ? pw : x+w;
+        if(  x0 >= x1  ) { memset(d, 0, dw); return; }
+        if(  x0 > x  ) memset(d, 0, x0-x);
+        memcpy(d + (x0-x), row + x0, x1-x0);
+        if(  x+w > x1  ) memset(d + (x1-x), 0, x+w-x1);
+        return;
+    }
+    uint32_t step = (uint32_t)(((uint64_t)w << 16)/dw);         // 16.16 plane px per dst px
+    uint32_t fx = step/2;                                       // Sample dst pixel centers
+    for( int i=0; i<dw; i++, fx+=step )
+    {
+        int px = x + (int)(fx >> 16);
+        d[i] = ((px < 0) || (px >= pw)) ? 0 : row[px];
+    }
+}
+
+int NoiseShm_read(NoiseShm *s, int seen, int x, int y, int w, int h, uint8_t *dst, int dw, int dh)
+{
+    /* *************DOC***************
+     * Copy the w x h viewport at screen x,y of the newest frame into dst,
+     * dw x dh pixels. Viewport and plane are in screen coordinates (SDL
+     * window points). If dst is a different size (HiDPI output, or render
+     * size divided down), the viewport is resampled (nearest) to fit.
+     * Parts of the viewport off the served plane are zero (no static).
+     *
+     * seen : frame number returned by the last read, -1 for none.
+     *        Frame numbers wrap: compare them for equality only.
+     * Return the frame number copied. If no frame is newer than seen,
+     * dst is left alone and seen is returned. If every copy got torn by
+     * the server (reader more than a ring behind), seen is returned too,
+     * but dst may hold a mix of frames: it is still static.
+     * *******************************/
+    Uint32 frames = (Uint32)SDL_AtomicGet(&s->hdr->frame);
+    int newest = (int)(frames - 1);
+    if(  (frames == 0) || (newest == seen)  ) return seen;
+    int pw = s->hdr->w; int ph = s->hdr->h;
+    x -= s->hdr->x; y -= s->hdr->y;                             // Screen to plane
+    if(  (w <= 0) || (h <= 0) || (dw <= 0) || (dh <= 0)  ) return seen;
+    uint32_t step = (uint32_t)(((uint64_t)h << 16)/dh);         // 16.16 plane rows per dst row
+    for( int tries=0; tries<4; tries++ )
+    {
+        int slot = (Uint32)newest % NOISE_SHM_SLOTS;
+        int seq = SDL_AtomicGet(&s->hdr->seq[slot]);
+        if(  seq & 1  ) { newest = (int)((Uint32)SDL_AtomicGet(&s->hdr->frame) - 1); continue; }
+        SDL_MemoryBarrierAcquire();                             // seq before plane reads
+        const uint8_t *plane = s->planes + (size_t)slot*pw*ph;
+        uint32_t fy = (dh == h) ? 0 : step/2;                   // Sample dst row centers
+        for( int row=0; row<dh; row++, fy+=step )
+        {
+            uint8_t *d = dst + (size_t)row*dw;
+            int py = y + (int)(fy >> 16);
+            if(  (py < 0) || (py >= ph)  ) { memset(d, 0, dw); continue; }
+            NoiseShm_copy_row(plane, pw, py, x, w, d, dw);
+        }
+        SDL_MemoryBarrierAcquire();                             // Plane reads before seq
+        if(  SDL_AtomicGet(&s->hdr->seq[slot]) == seq  ) return newest;
+        newest = (int)((Uint32)SDL_AtomicGet(&s->hdr->frame) - 1);   // Torn : try the newest
+    }
+    return seen;
+}
+
+#endif // __NOISE_SHM_H__
@@ -1,74 +1,366 @@
 /* *************DOC***************
  * $ ./parse-headers.exe        -- list all headers
  * $ ./parse-headers.exe M      -- only list headers for my libs
+ * $ ctags -f - -L headers-stale.txt > DIR/stale.ctags &&
+ *   ./parse-headers.exe split [M] < DIR/stale.ctags
+ *                              -- split one ctags run into tag files
+ *
+ * Reads:
+ *      headers-M.txt       : output of gcc -M, any number of sources
+ * Writes:
+ *      headers.txt         : every header, listed once
+ *      headers-tags.txt    : the tag file for every header (merge these)
+ *      headers-stale.txt   : each header to re-tag (ctags -L input)
+ *      DIR/cache.txt       : "mtime tagfile header" for the next run
+ *      DIR/cache-stale.txt : the same for stale headers, until split
+ *
+ * DIR is .tags for M and .lib-tags for all headers.
+ *
+ * A header is stale if it is new, its mtime changed, or its tag file is
+ * missing. Only stale headers need ctags, the rest reuse their tag file.
+ * All stale headers go to one ctags run: split mode writes each tag line
+ * to the tag file of the header in its file field.
+ *
+ * cache.txt only lists fresh headers. Split moves the stale ones over
+ * from cache-stale.txt after it writes their tag files, so if ctags fails
+ * (and split never runs) they are still stale next run.
+ *
+ * My libs are headers with a relative path. System headers have an
+ * absolute path: /usr/include/..., C:/msys64/...
  * *******************************/
+#define _POSIX_C_SOURCE 200809L                                 // stat, mmap
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-typedef enum _state__def { STR, SEP } state;        // State is STRING or SEPARATOR
-state update_state(const char c)
+typedef struct
 {
-    state st = ((c == ' ') || (c == '\\') || (c == '\n')) ? SEP : STR;
-    return st;
+    const char *buf;                                            // File contents
+    size_t len;                                                 // Bytes in buf
+    bool mapped;                                                // mmap or malloc
+} Text;
+
+bool text_open(Text *t, const char *path)
+{ // Map the whole file into memory (read it on Windows)
+    t->buf = NULL; t->len = 0; t->mapped = false;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if(  fd < 0  ) return false;
+    struct stat st;
+    if(  fstat(fd, &st) != 0  ) { close(fd); return false; }
+    t->len = st.st_size;
+    if(  t->len > 0  )
+    {
+        void *p = mmap(NULL, t->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(  p == MAP_FAILED  ) { close(fd); return false; }
+        t->buf = p; t->mapped = true;
+    }
+    close(fd);                                                  // Mapping stays valid
+    return true;
+#else
+    FILE *f = fopen(path, "rb");
+    if(  f == NULL  ) return false;
+    fseek(f, 0, SEEK_END); long n = ftell(f); fseek(f, 0, SEEK_SET);
+    char *p = malloc(n > 0 ? n : 1);
+    t->len = fread(p, 1, n, f);
+    t->buf = p;
+    fclose(f);
+    return true;
+#endif
+}
+
+void text_close(Text *t)
+{
+#ifndef _WIN32
+    if(  t->mapped  ) { munmap((void *)t->buf, t->len); return; }
+#endif
+    free((void *)t->buf);
+}
+
+/* *************Header set***************
+ * Open-addressing hash set of header paths.
+ * Keeps insertion order in list[] so headers.txt is stable.
+ * *******************************/
+typedef struct
+{
+    char *path;
+    char tagfile[64];                                           // DIR/<hash>.tags
+    uint64_t hash;
+    long long mtime;                                            // From cache
+    bool cached;                                                // Found in cache
+} Header;
+
+typedef struct
+{
+    Header *list; int cnt; int cap;                             // Headers in order
+    int *slots; int nslots;                                     // Index+1 into list, 0 : empty
+} HeaderSet;
+
+uint64_t fnv1a(const char *s, size_t n)
+{ // 64-bit FNV-1a hash
+    uint64_t h = 14695981039346656037ull;
+    for( size_t i=0; i<n; i++ ) { h ^= (unsigned char)s[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+void set_grow(HeaderSet *s)
+{ // Double the slot table and re-insert
+    int n = s->nslots ? 2*s->nslots : 1024;
+    int *slots = calloc(n, sizeof(int));
+    for( int i=0; i<s->cnt; i++ )
+    {
+        int k = s->list[i].hash & (n-1);
+        while(  slots[k]  ) { k = (k+1) & (n-1); }
+        slots[k] = i+1;
+    }
+    free(s->slots);
+    s->slots = slots; s->nslots = n;
+}
+
+Header *set_add(HeaderSet *s, const char *path, size_t n, bool *added)
+{ // Find path, or add it. Path need not be null-terminated.
+    if(  2*(s->cnt+1) > s->nslots  ) set_grow(s);
+    uint64_t h = fnv1a(path, n);
+    int k = h & (s->nslots-1);
+    while(  s->slots[k]  )
+    {
+        Header *e = &s->list[s->slots[k]-1];
+        if(  (e->hash == h) && (strlen(e->path) == n) && (memcmp(e->path, path, n) == 0)  )
+        {
+            *added = false; return e;
+        }
+        k = (k+1) & (s->nslots-1);
+    }
+    if(  s->cnt == s->cap  )
+    {
+        s->cap = s->cap ? 2*s->cap : 256;
+        s->list = realloc(s->list, s->cap*sizeof(Header));
+    }
+    Header *e = &s->list[s->cnt];
+    e->path = malloc(n+1); memcpy(e->path, path, n); e->path[n] = '\0';
+    e->hash = h; e->tagfile[0] = '\0'; e->mtime = 0; e->cached = false;
+    s->cnt++;
+    s->slots[k] = s->cnt;
+    *added = true;
+    return e;
+}
+
+long long file_mtime(const char *path)
+{ // Modification time in ns (seconds on Windows), -1 if missing
+    struct stat st;
+    if(  stat(path, &st) != 0  ) return -1;
+#ifndef _WIN32
+    return (long long)st.st_mtim.tv_sec*1000000000 + st.st_mtim.tv_nsec;
+#else
+    return (long long)st.st_mtime;
+#endif
+}
+
+bool is_my_lib(const char *p)
+{ // Relative path : my lib. Absolute path : system lib.
+    if(  (p[0] == '/') || (p[0] == '\\')  ) return false;
+    if(  (p[0] != '\0') && (p[1] == ':')  ) return false;      // C:/...
+    return true;
+}
+
+/* *************Tokenizer***************
+ * gcc -M output:
+ *
+ *      main.o: main.c /usr/include/stdio.h \
+ *       window_info.h
+ *      tv-static.o: tv-static.c ...
+ *
+ * Tokens are separated by spaces and line breaks. "\<newline>" continues
+ * a rule. "\<space>" is a space inside a path.
+ *
+ * A token ending in ':' is a rule target. The token after it is the
+ * source file. Every other token is a header.
+ * *******************************/
+size_t next_token(const char *b, size_t len, size_t i, char *tok, size_t *tok_len, size_t tok_cap)
+{ // Copy the token at or after b[i] into tok. Return index after the token.
+    while(  i < len  )                                          // Skip separators
+    {
+        char c = b[i];
+        if(  (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')  ) { i++; continue; }
+        if(  (c == '\\') && (i+1 < len) && ((b[i+1] == '\n') || (b[i+1] == '\r'))  ) { i++; continue; }
+        break;
+    }
+    size_t n = 0;
+    while(  i < len  )
+    {
+        char c = b[i];
+        if(  (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')  ) break;
+        if(  c == '\\'  )
+        {
+            if(  (i+1 < len) && ((b[i+1] == '\n') || (b[i+1] == '\r'))  ) break;
+            if(  (i+1 < len) && (b[i+1] == ' ')  ) { c = ' '; i++; }   // Escaped space
+        }
+        if(  n+1 < tok_cap  ) tok[n++] = c;
+        i++;
+    }
+    *tok_len = n;
+    return i;
+}
+
+void load_cache(HeaderSet *s, const char *path)
+{ // Read "mtime tagfile header" lines from the last run
+    FILE *f = fopen(path, "r");
+    if(  f == NULL  ) return;                                   // First run
+    char line[4096];
+    while(  fgets(line, sizeof(line), f)  )
+    {
+        long long mtime; char tagfile[64]; int off;
+        if(  sscanf(line, "%lld %63s %n", &mtime, tagfile, &off) != 2  ) continue;
+        char *p = line + off;
+        size_t n = strcspn(p, "\r\n");
+        bool added;
+        Header *e = set_add(s, p, n, &added);
+        e->mtime = mtime; e->cached = true;
+        strcpy(e->tagfile, tagfile);
+    }
+    fclose(f);
+}
+
+void tagfile_of(const char *dir, const char *path, size_t n, char *tagfile, size_t cap)
+{ // DIR/<hash>.tags for header path
+    snprintf(tagfile, cap, "%s/%016llx.tags", dir, (unsigned long long)fnv1a(path, n));
+}
+
+int split_tags(const char *dir)
+{
+    /* *************DOC***************
+     * Read tag lines ("name<TAB>file<TAB>address...") on stdin and write
+     * each to the tag file of its file. Every header in cache-stale.txt
+     * gets its tag file emptied first, so a header without tags still
+     * has one (and is not stale next run).
+     *
+     * Then append those headers to cache.txt: only now are their tag
+     * files up to date.
+     * *******************************/
+    char stale_path[256]; snprintf(stale_path, sizeof(stale_path), "%s/cache-stale.txt", dir);
+    char cache_path[256]; snprintf(cache_path, sizeof(cache_path), "%s/cache.txt", dir);
+    FILE *stale = fopen(stale_path, "r");
+    if(  stale == NULL  ) { printf("Cannot read %s\n", stale_path); return EXIT_FAILURE; }
+    char line[4096]; char tagfile[64];
+    HeaderSet done = {0};                                       // Headers with a tag file
+    while(  fgets(line, sizeof(line), stale)  )
+    {
+        long long mtime; int off;
+        if(  sscanf(line, "%lld %63s %n", &mtime, tagfile, &off) != 2  ) continue;
+        FILE *f = fopen(tagfile, "w");
+        if(  f == NULL  ) continue;                             // Stays stale
+        fclose(f);
+        bool added; Header *e = set_add(&done, line+off, strcspn(line+off, "\r\n"), &added);
+        e->mtime = mtime; strcpy(e->tagfile, tagfile);
+    }
+    fclose(stale);
+    FILE *f = NULL;                                             // Tag file being written
+    char cur[4096] = "";                                        // Its header
+    while(  fgets(line, sizeof(line), stdin)  )
+    {
+        if(  strncmp(line, "!_TAG_", 6) == 0  ) continue;       // ctags pseudo-tags
+        char *file = strchr(line, '\t');
+        if(  file == NULL  ) continue;
+        file++;
+        size_t n = strcspn(file, "\t\r\n");
+        if(  (strlen(cur) != n) || (strncmp(cur, file, n) != 0)  )
+        { // Lines come grouped by file: only switch files on a new header
+            if(  f  ) fclose(f);
+            memcpy(cur, file, n); cur[n] = '\0';
+            tagfile_of(dir, cur, n, tagfile, sizeof(tagfile));
+            f = fopen(tagfile, "a");
+        }
+        if(  f  ) fputs(line, f);
+    }
+    if(  f  ) fclose(f);
+    FILE *c = fopen(cache_path, "a");
+    if(  c == NULL  ) { printf("Cannot write %s\n", cache_path); return EXIT_FAILURE; }
+    for( int i=0; i<done.cnt; i++ )
+    {
+        fprintf(c, "%lld %s %s\n", done.list[i].mtime, done.list[i].tagfile, done.list[i].path);
+    }
+    fclose(c);
+    remove(stale_path);
+    return EXIT_SUCCESS;
 }
-#define STR_OK (  (cnt>2) && (ignore==false)  )
 
 int main(int argc, char *argv[])
 {
-    // Check for cmdline flag M
+    // Check for cmdline flags M and split
     bool just_tag_my_libs = false;
+    bool split = false;
+    for( int i=1; i<argc; i++ )
     {
-        if(argc>1) if(argv[1][0]=='M') if(argv[1][1]=='\0') just_tag_my_libs = true;
+        if(  strcmp(argv[i], "M") == 0  ) just_tag_my_libs = true;
+        if(  strcmp(argv[i], "split") == 0  ) split = true;
     }
+    const char *dir = just_tag_my_libs ? ".tags" : ".lib-tags";   // Tag file cache
+    if(  split  ) return split_tags(dir);
+    char cache_path[256]; snprintf(cache_path, sizeof(cache_path), "%s/cache.txt", dir);
+    char stale_path[256]; snprintf(stale_path, sizeof(stale_path), "%s/cache-stale.txt", dir);
 
-    FILE *f = fopen("headers-M.txt", "r");                      // Read output from gcc -M
-    FILE *o = fopen("headers.txt", "w");                        // Write headers for ctags
+    Text t;
+    if(  !text_open(&t, "headers-M.txt")  )                     // Read output from gcc -M
+    {
+        printf("Cannot read headers-M.txt\n"); return EXIT_FAILURE;
+    }
 
-    { // Parse headers.txt for header paths
-        state st = SEP;                             // Initial state: outside of a STRING
-        int cnt = 0;                                // Initial STRING count: 0
-        int c;                                      // Parse file one character at a time
-        bool ignore = false;                        // State: ignore this string or not
-        while( (c=fgetc(f)) != EOF )
+    HeaderSet cache = {0}; load_cache(&cache, cache_path);      // Last run
+    HeaderSet hdrs = {0};                                       // This run
+    { // Parse headers-M.txt for header paths
+        char tok[4096]; size_t n;
+        size_t i = 0;
+        bool skip_next = false;                                 // Next token is a source
+        while(  true  )
         {
-            switch(st)
-            {
-                case SEP:                           // Outside a STRING
-                    st = update_state(c);           // Update state
-                    switch(st)                      // Do action based on new state
-                    {
-                        case STR:                   // Start of a new STRING
-                            if(just_tag_my_libs)    // Ignore paths that start with C
-                            {
-                                if(c=='C') ignore = true;
-                                else ignore = false;
-                            }
-                            cnt++;                  // Increment STRING counter
-                            if(STR_OK) putc(c, o);  // Print all strings after first two: "blah.o: blah.c"
-                            break;
-                        case SEP:                   // Still outside a STRING
-                            break;                  // Do nothing
-                    }
-                    break;
-                case STR:                           // Inside a STRING
-                    st = update_state(c);           // Update state
-                    switch(st)                      // Do action based on new state
-                    {
-                        case STR:                   // Still inside a STRING
-                            if(STR_OK) putc(c, o);  // Still printing this STRING
-                            break;
-                        case SEP:                   // STRING is finished
-                            if(STR_OK) putc('\n', o); // Add a newline after all the strings I keep
-                            break;
-                        default: printf("Unexpected state: %d", st); fclose(f); return EXIT_FAILURE;
-                    }
-                    break;
-                default: printf("Unexpected state: %d", st); fclose(f); return EXIT_FAILURE;
-            }
+            i = next_token(t.buf, t.len, i, tok, &n, sizeof(tok));
+            if(  n == 0  ) break;                               // End of file
+            if(  tok[n-1] == ':'  ) { skip_next = true; continue; }   // "blah.o:"
+            if(  skip_next  ) { skip_next = false; continue; }         // "blah.c"
+            tok[n] = '\0';
+            if(  just_tag_my_libs && !is_my_lib(tok)  ) continue;
+            bool added; set_add(&hdrs, tok, n, &added);         // Deduplicate
         }
     }
+    text_close(&t);
+
+    FILE *o = fopen("headers.txt", "w");                        // Write headers for ctags
+    FILE *all = fopen("headers-tags.txt", "w");                 // Tag files to merge
+    FILE *stale = fopen("headers-stale.txt", "w");              // Tag files to rebuild
+    FILE *c = fopen(cache_path, "w");                           // Cache for next run
+    FILE *cs = fopen(stale_path, "w");                          // Cached by split
+    if(  (o == NULL) || (all == NULL) || (stale == NULL)  )
+    {
+        printf("Cannot write header lists\n"); return EXIT_FAILURE;
+    }
+    if(  (c == NULL) || (cs == NULL)  ) printf("Cannot write %s (make the directory first)\n", cache_path);
+    int stale_cnt = 0;
+    for( int i=0; i<hdrs.cnt; i++ )
+    {
+        Header *h = &hdrs.list[i];
+        tagfile_of(dir, h->path, strlen(h->path), h->tagfile, sizeof(h->tagfile));
+        long long mtime = file_mtime(h->path);
+        bool added; Header *old = set_add(&cache, h->path, strlen(h->path), &added);
+        bool fresh = (!added) && old->cached && (old->mtime == mtime) && (file_mtime(h->tagfile) >= 0);
+        fprintf(o, "%s\n", h->path);
+        fprintf(all, "%s\n", h->tagfile);
+        if(  !fresh  ) { fprintf(stale, "%s\n", h->path); stale_cnt++; }
+        FILE *hc = fresh ? c : cs;                              // Stale : not cached until split
+        if(  hc  ) fprintf(hc, "%lld %s %s\n", mtime, h->tagfile, h->path);
+    }
+    if(  cs  ) fclose(cs);
+    if(  c  ) fclose(c);
+    fclose(stale);
+    fclose(all);
     fclose(o);
-    fclose(f);
+    printf("%d headers, %d to re-tag\n", hdrs.cnt, stale_cnt);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,164 @@
+#ifndef __RENDERER_INFO_H__
+#define __RENDERER_INFO_H__
+/* *************DOC***************
+ * Pick the SDL render backend and its flags, or compare all backends.
+ *
+ * SDL_CreateRenderer(win, -1, 0) takes the first backend that works,
+ * with whatever flags it has. These env vars pick instead:
+ *
+ *      TV_RENDERER=name        : opengl, opengles2, software, direct3d, ...
+ *      TV_RENDERER=compare     : run the program's workload on every
+ *                                backend, print a table, and quit
+ *      TV_RENDERER_FLAGS=list  : comma separated: software, accelerated,
+ *                                vsync, target
+ *      TV_FRAMES=n             : frames per backend in compare (default 300)
+ *
+ * Unknown names and backends that fail fall back to SDL's choice. The
+ * backend in use is printed at startup.
+ *
+ * Include window_info.h first: compare makes a fresh window per backend
+ * (some backends need their own window flags).
+ * *******************************/
+/* *************Example***************
+ *      RendererInfo rI; RendererInfo_setup(&rI);
+ *      if(  rI.compare  ) { RendererInfo_compare(&rI, argv[0], &wI, loads, load_cnt); ... quit }
+ *      ren = RendererInfo_create(&rI, win);
+ * *******************************/
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+typedef struct
+{
+    int index;                                                  // Render driver, -1 : SDL picks
+    Uint32 flags;                                               // SDL_RENDERER_*
+    bool compare;                                               // TV_RENDERER=compare
+    int frames;                                                 // Frames per backend in compare
+} RendererInfo;
+
+/* *************Workload***************
+ * One frame of the program's work, ending in SDL_RenderPresent.
+ *
+ *      frame_cnt == 0  : first frame on a new renderer, make textures
+ *      frame_cnt == -1 : renderer is about to go, free textures
+ * *******************************/
+typedef struct
+{
+    const char *name;                                           // Row label
+    void (*frame)(SDL_Renderer *ren, int frame_cnt, void *data);
+    void *data;
+} RendererWorkload;
+
+int RendererInfo_index(const char *name)
+{ // Render driver index with this name, -1 if none
+    for( int i=0; i<SDL_GetNumRenderDrivers(); i++ )
+    {
+        SDL_RendererInfo info;
+        if(  (SDL_GetRenderDriverInfo(i, &info) == 0) && (strcmp(info.name, name) == 0)  ) return i;
+    }
+    return -1;
+}
+
+Uint32 RendererInfo_parse_flags(const char *s)
+{ // "software,vsync" -> SDL_RENDERER_SOFTWARE | SDL_RENDERER_PRESENTVSYNC
+    Uint32 flags = 0;
+    if(  strstr(s, "software")  )    flags |= SDL_RENDERER_SOFTWARE;
+    if(  strstr(s, "accelerated")  ) flags |= SDL_RENDERER_ACCELERATED;
+    if(  strstr(s, "vsync")  )       flags |= SDL_RENDERER_PRESENTVSYNC;
+    if(  strstr(s, "target")  )      flags |= SDL_RENDERER_TARGETTEXTURE;
+    return flags;
+}
+
+void RendererInfo_flags_str(Uint32 flags, char *buf, size_t n)
+{ // SDL_RENDERER_* flags as "software,vsync" ("none" for 0)
+    snprintf(buf, n, "%s%s%s%s",
+            (flags & SDL_RENDERER_SOFTWARE) ? "software," : "",
+            (flags & SDL_RENDERER_ACCELERATED) ? "accelerated," : "",
+            (flags & SDL_RENDERER_PRESENTVSYNC) ? "vsync," : "",
+            (flags & SDL_RENDERER_TARGETTEXTURE) ? "target," : "");
+    size_t len = strlen(buf);
+    if(  len == 0  ) snprintf(buf, n, "none");
+    else buf[len-1] = '\0';                                     // Drop trailing comma
+}
+
+void RendererInfo_setup(RendererInfo *rI)
+{ // Read TV_RENDERER and TV_RENDERER_FLAGS
+    rI->index = -1; rI->flags = 0; rI->compare = false;
+    rI->frames = getenv("TV_FRAMES") ? atoi(getenv("TV_FRAMES")) : 300;
+    if(  rI->frames <= 0  ) rI->frames = 300;
+    const char *name = getenv("TV_RENDERER");
+    if(  name && (strcmp(name, "compare") == 0)  ) rI->compare = true;
+    else if(  name  )
+    {
+        rI->index = RendererInfo_index(name);
+        if(  rI->index < 0  ) printf("No renderer named %s, SDL picks\n", name);
+    }
+    if(  getenv("TV_RENDERER_FLAGS")  ) rI->flags = RendererInfo_parse_flags(getenv("TV_RENDERER_FLAGS"));
+}
+
+void RendererInfo_print(SDL_Renderer *ren)
+{ // Print the backend and flags in use
+    SDL_RendererInfo info;
+    if(  SDL_GetRendererInfo(ren, &info) != 0  ) return;
+    char flags[64]; RendererInfo_flags_str(info.flags, flags, sizeof(flags));
+    printf("Renderer: %s (%s)\n", info.name, flags);
+}
+
+SDL_Renderer *RendererInfo_create(RendererInfo *rI, SDL_Window *win)
+{ // Create the renderer asked for, or SDL's choice if that fails
+    SDL_Renderer *ren = SDL_CreateRenderer(win, rI->index, rI->flags);
+    if(  (ren == NULL) && ((rI->index != -1) || (rI->flags != 0))  )
+    {
+        printf("Cannot create that renderer (%s), SDL picks\n", SDL_GetError());
+        ren = SDL_CreateRenderer(win, -1, 0);
+    }
+    if(  ren  ) RendererInfo_print(ren);
+    return ren;
+}
+
+void RendererInfo_compare(RendererInfo *rI, const char *title, WindowInfo *wI,
+                          RendererWorkload *loads, int load_cnt)
+{
+    /* *************DOC***************
+     * Run each workload for rI->frames frames on every backend that can
+     * be created with rI->flags, and print frame time per backend.
+     * *******************************/
+    char flags[64]; RendererInfo_flags_str(rI->flags, flags, sizeof(flags));
+    printf("# Renderer comparison: %d frames each, flags: %s\n", rI->frames, flags);
+    printf("%-12s %-12s %10s %10s %8s\n", "renderer", "workload", "median_ms", "p99_ms", "fps");
+    double *t = malloc(sizeof(double)*rI->frames);
+    double ms_per_tick = 1e3/SDL_GetPerformanceFrequency();
+    for( int i=0; i<SDL_GetNumRenderDrivers(); i++ )
+    {
+        SDL_RendererInfo info; SDL_GetRenderDriverInfo(i, &info);
+        SDL_Window *win = SDL_CreateWindow(title, wI->x, wI->y, wI->w, wI->h, wI->flags);
+        SDL_Renderer *ren = win ? SDL_CreateRenderer(win, i, rI->flags) : NULL;
+        if(  ren == NULL  )
+        {
+            printf("%-12s %-12s %s\n", info.name, "-", "unavailable");
+            if(  win  ) SDL_DestroyWindow(win);
+            continue;
+        }
+        for( int l=0; l<load_cnt; l++ )
+        {
+            for( int f=0; f<rI->frames; f++ )
+            {
+                SDL_PumpEvents();                               // Keep the window responsive
+                Uint64 t0 = SDL_GetPerformanceCounter();
+                loads[l].frame(ren, f, loads[l].data);
+                t[f] = (SDL_GetPerformanceCounter() - t0)*ms_per_tick;
+            }
+            loads[l].frame(ren, -1, loads[l].data);             // Free textures
+            Stats st = stats_summary(t, rI->frames);            // Sorts t
+            printf("%-12s %-12s %10.3f %10.3f %8.1f\n", info.name, loads[l].name,
+                    st.median, st.p99, st.median > 0 ? 1e3/st.median : 0);
+        }
+        SDL_DestroyRenderer(ren);
+        SDL_DestroyWindow(win);
+    }
+    free(t);
+}
+
+#endif // __RENDERER_INFO_H__
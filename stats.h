@@ -0,0 +1,47 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+/* *************DOC***************
+ * Summary statistics of timing samples: min, median, mean, stddev, p99,
+ * max. No timer here: bench.h times headless benchmarks, renderer_info.h
+ * times frames with the SDL counter, both summarize with this.
+ * *******************************/
+/* *************Example***************
+ *      double t[REPS]; ... one sample per repetition ...
+ *      Stats st = stats_summary(t, REPS);                  // sorts t
+ * *******************************/
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct
+{
+    double min, median, mean, stddev, p99, max;
+} Stats;
+
+int stats_cmp_double(const void *a, const void *b)
+{ // qsort ascending
+    double x = *(const double *)a; double y = *(const double *)b;
+    return (x>y) - (x<y);
+}
+
+Stats stats_summary(double *samples, int n)
+{
+    /* *************DOC***************
+     * Summarize n samples. Sorts samples in place.
+     * p99 is the nearest-rank 99th percentile.
+     * *******************************/
+    Stats st = {0};
+    if(  n < 1  ) return st;
+    qsort(samples, n, sizeof(double), stats_cmp_double);
+    double sum = 0; for(int i=0; i<n; i++) {sum += samples[i];}
+    st.mean = sum/n;
+    double var = 0; for(int i=0; i<n; i++) {var += (samples[i]-st.mean)*(samples[i]-st.mean);}
+    st.stddev = sqrt(var/n);
+    st.min = samples[0];
+    st.max = samples[n-1];
+    st.median = (n%2) ? samples[n/2] : 0.5*(samples[n/2-1] + samples[n/2]);
+    int k = (int)ceil(0.99*n) - 1; if(k<0) {k=0;}
+    st.p99 = samples[k];
+    return st;
+}
+
+#endif // __STATS_H__
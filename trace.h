@@ -0,0 +1,157 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+/* *************DOC***************
+ * Trace recorder: scoped markers, dumped as Chrome trace-event JSON.
+ * Open the dump in chrome://tracing or https://ui.perfetto.dev to see
+ * each block of each frame on a timeline, one row per thread.
+ *
+ * Build with -DTRACE (make ... TRACE=1) to record. Without it, every
+ * macro below compiles to nothing: zero cost.
+ *
+ * Each thread records into its own ring of TRACE_RING_SIZE events, so
+ * recording never locks and never waits on another thread. A full ring
+ * overwrites its oldest events: the dump is the most recent history.
+ * Events hold raw performance counter ticks (one counter read per
+ * marker end and begin, no math); the dump converts them to ns.
+ *
+ * The rings are found through a lock-free list: a thread pushes its ring
+ * on its first event. Rings are never freed (a dump after a thread exits
+ * still shows it).
+ *
+ * Environment:
+ *      TV_TRACE=path       : dump file (default trace.json)
+ * *******************************/
+/* *************Example***************
+ *      TRACE_THREAD("main");                           // Before starting threads
+ *      TRACE_BLOCK("Fill the polygon")
+ *      { // Fill the polygon
+ *          ...                                         // Don't break out: the
+ *      }                                               // block is a for-loop
+ *      TRACE_DUMP();                                   // Write TV_TRACE
+ * *******************************/
+#ifdef TRACE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_RING_SIZE (1<<16)                                 // Events per thread, power of 2
+#define TRACE_WRAP      (1<<30)                                 // Head wraps here, multiple of ring size
+
+typedef struct
+{
+    const char *name;                                           // String literal
+    Uint64 t0, t1;                                              // Begin, end (perf counter)
+} TraceEvent;
+
+typedef struct TraceRing
+{
+    TraceEvent ev[TRACE_RING_SIZE];
+    SDL_atomic_t head;                                          // Next event, mod TRACE_WRAP
+    SDL_atomic_t full;                                          // Ring has wrapped
+    SDL_threadID tid;
+    char thread_name[32];
+    struct TraceRing *next;                                     // All rings, newest first
+} TraceRing;
+
+typedef struct
+{
+    const char *name;
+    Uint64 t0;
+    bool on;                                                    // False : block is done
+} TraceScope;
+
+void *trace_rings;                                              // List head (TraceRing *)
+Uint64 trace_t_start;                                           // Perf counter at first ring
+_Thread_local TraceRing *trace_ring;                            // This thread's ring
+
+double trace_ns(Uint64 t)
+{ // Perf counter t to ns since the first ring was made
+    static Uint64 freq;
+    if(  freq == 0  ) freq = SDL_GetPerformanceFrequency();
+    Uint64 dt = t - trace_t_start;
+    return (double)(dt/freq)*1e9 + (double)(dt%freq)*1e9/freq;
+}
+
+TraceRing *trace_ring_get(void)
+{ // This thread's ring, made and listed on first use
+    if(  trace_ring  ) return trace_ring;
+    if(  trace_t_start == 0  ) trace_t_start = SDL_GetPerformanceCounter();   // First ring starts the clock
+    TraceRing *r = calloc(1, sizeof(TraceRing));
+    r->tid = SDL_ThreadID();
+    snprintf(r->thread_name, sizeof(r->thread_name), "thread %lu", (unsigned long)r->tid);
+    do { r->next = SDL_AtomicGetPtr(&trace_rings); }          // Push, lock-free
+    while(  !SDL_AtomicCASPtr(&trace_rings, r->next, r)  );
+    trace_ring = r;
+    return r;
+}
+
+void trace_thread(const char *name)
+{ // Name this thread's row in the trace
+    TraceRing *r = trace_ring_get();
+    snprintf(r->thread_name, sizeof(r->thread_name), "%s", name);
+}
+
+TraceScope trace_begin(const char *name)
+{
+    return (TraceScope){name, SDL_GetPerformanceCounter(), true};
+}
+
+void trace_end(TraceScope *s)
+{ // Record the block, end the for-loop
+    Uint64 t1 = SDL_GetPerformanceCounter();
+    TraceRing *r = trace_ring_get();
+    int head = SDL_AtomicGet(&r->head);                         // Only this thread writes
+    r->ev[head & (TRACE_RING_SIZE-1)] = (TraceEvent){s->name, s->t0, t1};
+    int next = (head + 1) & (TRACE_WRAP-1);
+    if(  (next & (TRACE_RING_SIZE-1)) == 0  ) SDL_AtomicSet(&r->full, 1);
+    SDL_AtomicSet(&r->head, next);                              // Publish (full barrier)
+    s->on = false;
+}
+
+void trace_dump(void)
+{
+    /* *************DOC***************
+     * Write every ring to TV_TRACE as Chrome trace JSON. Safe to call while
+     * other threads record: events they overwrite during the dump may show
+     * up torn, so the oldest few events of a busy ring are skipped.
+     * *******************************/
+    const char *path = getenv("TV_TRACE") ? getenv("TV_TRACE") : "trace.json";
+    FILE *f = fopen(path, "w");
+    if(  f == NULL  ) { printf("Cannot write trace: %s\n", path); return; }
+    fprintf(f, "{\"traceEvents\":[\n");
+    bool first = true; int total = 0;
+    for( TraceRing *r = SDL_AtomicGetPtr(&trace_rings); r; r = r->next )
+    {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", (unsigned long)r->tid, r->thread_name);
+        first = false;
+        int head = SDL_AtomicGet(&r->head);
+        int cnt = SDL_AtomicGet(&r->full) ? TRACE_RING_SIZE - 64 : head;   // Skip the oldest
+        for( int i=cnt; i>0; i-- )                              // Oldest first
+        {
+            TraceEvent e = r->ev[(head - i) & (TRACE_RING_SIZE-1)];
+            if(  (e.name == NULL) || (e.t1 < e.t0)  ) continue; // Torn by the writer
+            fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+                    e.name, (unsigned long)r->tid, trace_ns(e.t0)/1e3, (trace_ns(e.t1) - trace_ns(e.t0))/1e3);
+            total++;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    printf("Trace: %d events to %s\n", total, path);
+}
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+#define TRACE_S TRACE_CAT(trace_scope_, __LINE__)
+#define TRACE_BLOCK(name) for( TraceScope TRACE_S = trace_begin(name); TRACE_S.on; trace_end(&TRACE_S) )
+#define TRACE_THREAD(name) trace_thread(name)
+#define TRACE_DUMP() trace_dump()
+#else
+#define TRACE_BLOCK(name)
+#define TRACE_THREAD(name) ((void)0)
+#define TRACE_DUMP() ((void)0)
+#endif
+
+#endif // __TRACE_H__
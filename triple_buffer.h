@@ -0,0 +1,68 @@
+#ifndef __TRIPLE_BUFFER_H__
+#define __TRIPLE_BUFFER_H__
+/* *************DOC***************
+ * Lock-free triple buffer: one producer thread, one consumer thread.
+ *
+ * Three slots. The producer owns "back", the consumer owns "front", and
+ * "middle" is the hand-off. Publishing or acquiring is one atomic swap
+ * with middle, so neither side ever waits on the other:
+ *
+ *      producer : write back, then swap back <-> middle (mark fresh)
+ *      consumer : if middle is fresh, swap front <-> middle
+ *
+ * The consumer always gets the newest complete frame. Frames it was too
+ * slow to take are overwritten, never queued.
+ *
+ * The slots themselves live with the caller: TripleBuffer only hands out
+ * the indices 0, 1, 2.
+ * *******************************/
+/* *************Example***************
+ *      Frame frames[3]; TripleBuffer tb; TripleBuffer_init(&tb);
+ *
+ *      // Producer thread
+ *      make_frame(&frames[tb.back]);
+ *      TripleBuffer_publish(&tb);
+ *
+ *      // Consumer thread
+ *      TripleBuffer_acquire(&tb);                      // false : no new frame
+ *      show_frame(&frames[tb.front]);
+ * *******************************/
+#include <stdbool.h>
+
+#define TB_INDEX 3                                              // Bits: slot index
+#define TB_FRESH 4                                              // Bit: middle not taken yet
+
+typedef struct
+{
+    SDL_atomic_t middle;                                        // Slot index | TB_FRESH
+    int back;                                                   // Producer's slot
+    int front;                                                  // Consumer's slot
+} TripleBuffer;
+
+void TripleBuffer_init(TripleBuffer *tb)
+{
+    tb->back = 0;
+    SDL_AtomicSet(&tb->middle, 1);
+    tb->front = 2;
+}
+
+bool TripleBuffer_fresh(TripleBuffer *tb)
+{ // True if the last published frame is still waiting for the consumer
+    return SDL_AtomicGet(&tb->middle) & TB_FRESH;
+}
+
+void TripleBuffer_publish(TripleBuffer *tb)
+{ // Producer: back is complete, hand it off and take the old middle
+    SDL_MemoryBarrierRelease();                                 // Frame writes before swap
+    tb->back = SDL_AtomicSet(&tb->middle, tb->back | TB_FRESH) & TB_INDEX;
+}
+
+bool TripleBuffer_acquire(TripleBuffer *tb)
+{ // Consumer: take the newest frame if there is one. False : keep front.
+    if(  !TripleBuffer_fresh(tb)  ) return false;
+    tb->front = SDL_AtomicSet(&tb->middle, tb->front) & TB_INDEX;
+    SDL_MemoryBarrierAcquire();                                 // Swap before frame reads
+    return true;
+}
+
+#endif // __TRIPLE_BUFFER_H__
@@ -1,8 +1,251 @@
+#define _POSIX_C_SOURCE 200809L                                 // shm_open, mmap (noise_shm.h)
 #include <SDL.h>
 #include <stdbool.h>
+#include <string.h>
 #include "main.h"
 #include "window_info.h"
 #include "rand.h"
+#include "noise.h"
+#include "noise_dist.h"
+#include "composite.h"
+#include "latency.h"
+#include "triple_buffer.h"
+#include "trace.h"
+#include "noise_shm.h"
+#include "renderer_info.h"
+
+/* *************Generator thread***************
+ * Generating the static and presenting it run on different threads:
+ *
+ *      generator : tv_generate() into the back slot, publish
+ *      main      : UI, take the newest frame, render, present
+ *
+ * Frames go through a lock-free triple buffer, so a slow present never
+ * stalls generation and a slow frame never stalls present. The UI thread
+ * shares its settings with the generator through atomics in TvParams.
+ *
+ * The generator idles while its last frame is unshown, unless the settings
+ * changed since: then it makes a new frame over the unshown one, so the UI
+ * never presents a frame made before its input.
+ *
+ * TV_THREADED=0 : generate on the main thread instead
+ * *******************************/
+typedef struct
+{
+    SDL_FPoint *noise; int *alpha;                              // Rand points w rand alpha
+    int cap;                                                    // Allocated points
+    int count;                                                  // Points in this frame
+    Uint32 seq;                                                 // Settings it was made with
+    Uint64 look;                                                // Hash of those settings
+} TvFrame;
+
+typedef struct
+{ // Settings written by the UI, read by the generator
+    SDL_atomic_t w, h;                                          // Render size
+    SDL_atomic_t count;                                         // Points per frame
+    SDL_atomic_t max;                                           // TV alpha max
+    SDL_atomic_t counter;                                       // Counter-based noise
+    SDL_atomic_t dist;                                          // NoiseDistKind
+    SDL_atomic_t cluster;                                       // Points per grain clump
+    SDL_atomic_t seq;                                           // LatencyInfo_publish() of these
+    SDL_atomic_t quit;                                          // Stop the generator
+} TvParams;
+
+typedef struct
+{
+    TvParams p;
+    TvFrame frames[3];                                          // Triple buffer slots
+    TripleBuffer tb;
+    uint32_t frame;                                             // Frame counter
+    uint32_t seed;                                              // Noise seed
+    NoiseDist dist;                                             // Tables built once, kind per frame
+} TvShared;
+
+void tv_dist_setup(NoiseDist *d)
+{ // Alpha distribution and grain from TV_DIST, TV_HIST, TV_CLUSTER
+    noise_dist_init(d, getenv("TV_DIST") ? noise_dist_kind(getenv("TV_DIST")) : NOISE_DIST_UNIFORM);
+    const char *hist = getenv("TV_HIST");                       // Implies TV_DIST=hist
+    if(  hist && !noise_dist_parse_hist(d, hist)  ) printf("Bad TV_HIST, using default\n");
+    if(  hist  ) d->kind = NOISE_DIST_HIST;
+    d->cluster = getenv("TV_CLUSTER") ? atoi(getenv("TV_CLUSTER")) : 0;
+}
+
+Uint64 tv_look(int w, int h, int count, int max, int counter, int dist, int cluster)
+{ // Hash of the settings a frame of static shows (latency.h look)
+    int v[] = {w, h, count, max, counter, dist, cluster};
+    Uint64 look = 14695981039346656037ull;                      // FNV-1a
+    for( int i=0; i<7; i++ ) { look ^= (Uint32)v[i]; look *= 1099511628211ull; }
+    return look;
+}
+
+void tv_generate(TvShared *sh, TvFrame *f)
+{ // Generate one frame of TV Static into f
+    f->seq = SDL_AtomicGet(&sh->p.seq);                         // First : settings are this new
+    int w = SDL_AtomicGet(&sh->p.w); int h = SDL_AtomicGet(&sh->p.h);
+    int count = SDL_AtomicGet(&sh->p.count);
+    int tv_max = SDL_AtomicGet(&sh->p.max);
+    bool counter = SDL_AtomicGet(&sh->p.counter);
+    if(  count > f->cap  )
+    { // Grow mem for procedural art
+        f->cap = count + count/2;
+        f->noise = realloc(f->noise, sizeof(SDL_FPoint)*f->cap);   // Point locations
+        f->alpha = realloc(f->alpha, sizeof(int)*f->cap);          // Point alpha transparency
+    }
+    if(  counter  )
+    {
+        sh->dist.kind = SDL_AtomicGet(&sh->p.dist);             // Only the generator writes dist
+        sh->dist.cluster = SDL_AtomicGet(&sh->p.cluster);
+        noise_dist_fill_points(&sh->dist, f->noise, f->alpha, 0, count, w, h, sh->frame, sh->seed, tv_max);
+    }
+    else for(int i=0; i<count; i++)
+    {
+        f->noise[i] = (SDL_FPoint){w/2 + rand_pm(w/2), h/2 + rand_pm(h/2)};
+        f->alpha[i] = rand_0_to_max(tv_max);
+    }
+    f->count = count;
+    f->look = tv_look(w, h, count, tv_max, counter,             // rand() static has no dist
+                      counter ? sh->dist.kind : 0, counter ? sh->dist.cluster : 0);
+    sh->frame++;
+}
+
+int tv_generator(void *data)
+{ // Generator thread: make frames until told to quit
+    TvShared *sh = data;
+    TRACE_THREAD("generator");
+    Uint32 made = 0;                                            // Settings seq of the last frame
+    while(  !SDL_AtomicGet(&sh->p.quit)  )
+    {
+        if(  TripleBuffer_fresh(&sh->tb)                        // Newest frame not shown yet
+             && ((Uint32)SDL_AtomicGet(&sh->p.seq) == made)  )  // and made w the newest settings
+        {
+            SDL_Delay(1);                                       // Idle, don't spin
+            continue;
+        }
+        TRACE_BLOCK("Generate TV Static")
+        {
+            TvFrame *f = &sh->frames[sh->tb.back];
+            tv_generate(sh, f);
+            TripleBuffer_publish(&sh->tb);
+            made = f->seq;
+        }
+    }
+    return 0;
+}
+
+/* *************Shared static***************
+ * TV_SHM=serve  : no window. Generate static for the whole desktop into
+ *                 shared memory (noise_shm.h) until Ctrl-C or TV_FRAMES.
+ * TV_SHM=attach : copy this window's part of the served static instead
+ *                 of generating it. Generates its own if no server.
+ *
+ * Run one server and any number of overlays: static is generated once.
+ * The server sets the density, brightness and distribution (TV_DIST);
+ * overlays just show it.
+ * *******************************/
+int tv_serve(uint32_t seed, int frame_limit)
+{ // Server loop
+    SDL_Rect r = {0, 0, 1920, 1080};                            // Desktop, or this if headless
+    for( int d=0; d<SDL_GetNumVideoDisplays(); d++ )            // Union of all displays
+    {
+        SDL_Rect b;
+        if(  SDL_GetDisplayBounds(d, &b) != 0  ) continue;
+        if(  d == 0  ) { r = b; continue; }
+        SDL_UnionRect(&r, &b, &r);
+    }
+    NoiseShm shm;
+    if(  !NoiseShm_serve(&shm, r.x, r.y, r.w, r.h)  )
+    {
+        printf("Cannot create shared memory %s\n", NOISE_SHM_NAME);
+        return EXIT_FAILURE;
+    }
+    printf("Serving %dx%d static at %s\n", r.w, r.h, NOISE_SHM_NAME);
+    int count = 5000.0/(800*600)*r.w*r.h;                       // Same density as tv-static
+    SDL_FPoint *pts = malloc(sizeof(SDL_FPoint)*count);
+    int *alpha = malloc(sizeof(int)*count);
+    NoiseDist dist; tv_dist_setup(&dist);                       // Alpha distribution
+    bool quit = false;
+    int frame_cnt = 0;
+    while(  quit == false  )
+    {
+        SDL_Event e;
+        while(  SDL_PollEvent(&e)  ) { if(e.type == SDL_QUIT) {quit = true;} }   // Ctrl-C
+        TRACE_BLOCK("Generate TV Static")
+        {
+            noise_dist_fill_points(&dist, pts, alpha, 0, count, r.w, r.h, frame_cnt, seed, 255);
+            comp_scatter_points(NoiseShm_begin(&shm), r.w, r.h, pts, alpha, count);
+            NoiseShm_publish(&shm);
+        }
+        SDL_Delay(10);                                          // Same pace as the overlays
+        frame_cnt++;
+        if(  frame_limit && (frame_cnt >= frame_limit)  ) quit = true;
+    }
+    free(pts); free(alpha);
+    NoiseShm_close(&shm);
+    TRACE_DUMP();
+    SDL_Quit();
+    return EXIT_SUCCESS;
+}
+
+/* *************Renderer compare***************
+ * TV_RENDERER=compare : time both render paths on each backend
+ * (renderer_info.h), window size from WindowInfo, default density.
+ * *******************************/
+typedef struct
+{
+    int w, h, count;
+    SDL_FPoint *pts; int *alpha;                                // Static points
+    uint8_t *plane;                                             // Static alpha plane
+    SDL_Texture *tex;                                           // Composited frame
+} TvLoad;
+
+void tv_load_sdl(SDL_Renderer *ren, int frame_cnt, void *data)
+{ // SDL path: clear, blend every point, present
+    TvLoad *L = data;
+    if(  frame_cnt < 0  ) return;
+    if(  frame_cnt == 0  ) SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+    noise_fill_points(L->pts, L->alpha, 0, L->count, L->w, L->h, frame_cnt, 1, 255);
+    SDL_SetRenderDrawColor(ren, 10, 10, 10, 0);
+    SDL_RenderClear(ren);
+    for(int i=0; i<L->count; i++)
+    {
+        SDL_SetRenderDrawColor(ren, 255, 255, 255, L->alpha[i]);
+        SDL_RenderDrawPointF(ren, L->pts[i].x, L->pts[i].y);
+    }
+    SDL_RenderPresent(ren);
+}
+
+void tv_load_composite(SDL_Renderer *ren, int frame_cnt, void *data)
+{ // CPU compositor path: one pass, one upload, present
+    TvLoad *L = data;
+    if(  frame_cnt < 0  ) { SDL_DestroyTexture(L->tex); L->tex = NULL; return; }
+    if(  frame_cnt == 0  ) L->tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+                                                      SDL_TEXTUREACCESS_STREAMING, L->w, L->h);
+    noise_fill_points(L->pts, L->alpha, 0, L->count, L->w, L->h, frame_cnt, 1, 255);
+    comp_scatter_points(L->plane, L->w, L->h, L->pts, L->alpha, L->count);
+    Uint32 *px; int pitch;
+    SDL_LockTexture(L->tex, NULL, (void **)&px, &pitch);
+    comp_frame(px, pitch/4, L->w, L->h, comp_argb(10, 10, 10, 255), NULL, 0, 0, L->plane);
+    SDL_UnlockTexture(L->tex);
+    SDL_RenderCopy(ren, L->tex, NULL, NULL);
+    SDL_RenderPresent(ren);
+}
+
+int tv_compare(RendererInfo *rI, const char *title, WindowInfo *wI)
+{ // Compare backends, then quit
+    TvLoad L = {.w = wI->w, .h = wI->h};
+    L.count = 5000.0/(800*600)*L.w*L.h;
+    L.pts = malloc(sizeof(SDL_FPoint)*L.count);
+    L.alpha = malloc(sizeof(int)*L.count);
+    L.plane = malloc((size_t)L.w*L.h);
+    RendererWorkload loads[] = {
+        {"sdl",         tv_load_sdl,        &L},
+        {"composite",   tv_load_composite,  &L},
+    };
+    RendererInfo_compare(rI, title, wI, loads, 2);
+    free(L.pts); free(L.alpha); free(L.plane);
+    SDL_Quit();
+    return EXIT_SUCCESS;
+}
 
 void shutdown()
 {
@@ -19,13 +262,75 @@ int main(int argc, char *argv[])
     rand_init();                                                // seed rand()
     SDL_Init(SDL_INIT_VIDEO);
     WindowInfo wI; WindowInfo_setup(&wI, argc, argv);           // Init game window info
+    LatencyInfo lI; LatencyInfo_setup(&lI, SDLK_d);             // Input-to-photon latency, d : next dist
+    TRACE_THREAD("main");                                       // Trace row, before threads
+    const char *tv_shm = getenv("TV_SHM") ? getenv("TV_SHM") : ""; // serve, attach, or off
+    if(  strcmp(tv_shm, "serve") == 0  )                        // No window, just serve static
+    {
+        uint32_t seed = getenv("TV_SEED") ? (uint32_t)atoi(getenv("TV_SEED")) : (uint32_t)rand();
+        return tv_serve(seed, getenv("TV_FRAMES") ? atoi(getenv("TV_FRAMES")) : 0);
+    }
+    RendererInfo rI; RendererInfo_setup(&rI);                   // Render backend and flags
+    if(  rI.compare  ) return tv_compare(&rI, argv[0], &wI);    // Time each backend, quit
     win = SDL_CreateWindow(argv[0], wI.x, wI.y, wI.w, wI.h, wI.flags);
-    ren = SDL_CreateRenderer(win, -1, 0);
+    ren = RendererInfo_create(&rI, win);
     SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);       // Draw with alpha
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");      // Upscale w/o blur
+    SDL_RenderSetIntegerScale(ren, SDL_TRUE);                   // Whole-pixel upscale
 
     // Game state
     bool quit = false;
+    int frame_limit = getenv("TV_FRAMES") ? atoi(getenv("TV_FRAMES")) : 0; // 0 : run until Esc
+    int frame_cnt = 0;                                          // Frames presented
     int tv_max = 255;                                           // TV alpha max (brightness)
+    /* *************Noise density***************
+     * tv_by_area   : true  -- point count is tv_density * render area
+     *                false -- point count is fixed at tv_count
+     * tv_density   : points per render pixel (5000 points in 800x600)
+     * tv_res_div   : render static at 1/tv_res_div of the output size
+     *                and let SDL upscale it (nearest-neighbor)
+     *
+     * Cost is a function of render pixels: halving the resolution
+     * quarters the point count and the static grain gets chunkier.
+     * *******************************/
+    bool tv_by_area = true;                                     // Count from area
+    int tv_count = 5000;                                        // Fixed count
+    float tv_density = 5000.0/(800*600);                        // Points per pixel
+    int tv_res_div = 1;                                         // 1, 2, 4, 8
+    int tv_w = 0; int tv_h = 0;                                 // Render size
+    /* *************Noise generator***************
+     * tv_counter   : true  -- stateless noise_hash(x, y, frame, seed)
+     *                false -- rand() stream
+     * TV_SEED=n    : env var to reproduce the exact same static
+     *
+     * Counter-based static can shape its brightness (noise_dist.h):
+     * tv_dist      : uniform, gauss (mostly grey), exp (mostly dim, rare
+     *                sparks), hist (TV_HIST=w0,w1,... weights, dark to bright)
+     * tv_cluster   : points per grain clump, 0 -- no clumps
+     * TV_DIST=name, TV_CLUSTER=n : env vars to start with these
+     * *******************************/
+    bool tv_counter = true;                                     // Counter-based noise
+    TvShared sh; SDL_zero(sh); TripleBuffer_init(&sh.tb);       // Shared w generator
+    sh.seed = getenv("TV_SEED") ? (uint32_t)atoi(getenv("TV_SEED")) : (uint32_t)rand();
+    tv_dist_setup(&sh.dist);                                    // Before the generator starts
+    int tv_dist = sh.dist.kind;                                 // Alpha distribution
+    int tv_cluster = sh.dist.cluster;                           // Points per clump
+    int tv_cluster_on = tv_cluster > 1 ? tv_cluster : 8;        // Clump size when toggled on
+    NoiseShm tv_src;                                            // Served static (TV_SHM=attach)
+    bool tv_attached = (strcmp(tv_shm, "attach") == 0) && NoiseShm_attach(&tv_src);
+    if(  (strcmp(tv_shm, "attach") == 0) && !tv_attached  ) printf("No static server, generating\n");
+    int tv_src_seen = -1; Uint32 tv_src_ticks = SDL_GetTicks(); // Last frame copied, when
+    bool tv_threaded = !(getenv("TV_THREADED") && (atoi(getenv("TV_THREADED")) == 0));
+    SDL_Thread *tv_thread = NULL;                               // Started once not attached
+    /* *************Render path***************
+     * tv_composite : true  -- CPU compositor: bgnd and static in one pass
+     *                         over the frame, uploaded once as a texture
+     *                false -- SDL: clear, then blend every point
+     * *******************************/
+    bool tv_composite = true;                                   // CPU compositor
+    SDL_Texture *tv_tex = NULL;                                 // Composited frame
+    uint8_t *tv_plane = NULL;                                   // Static alpha plane
+    bool tv_letterbox = false;                                  // Output not a multiple of render size
     // Game loop
     while(  quit == false  )
     {
@@ -33,66 +338,183 @@ int main(int argc, char *argv[])
         // Some game state depends on window size
         SDL_GetWindowSize(win, &wI.w, &wI.h);                   // Get new window size
 
-        // Procedurally generated art
-        int count = 5000; SDL_FPoint *tv_noise; int *tv_alpha;// Rand points w rand alpha
-        { // Allocate mem for procedural art
-            tv_noise = malloc(sizeof(SDL_FPoint)*count);          // Point locations
-            tv_alpha = malloc(sizeof(int)*count);           // Point alpha transparency
-        }
-        { // Generate TV Static
-            for(int i=0; i<count; i++)
-            {
-                tv_noise[i] = (SDL_FPoint){wI.w/2 + rand_pm(wI.w/2), wI.h/2 + rand_pm(wI.h/2)};
-                tv_alpha[i] = rand_0_to_max(tv_max);
-            }
-        }
-
-        // UI
+        // UI : first, so input is in the settings this frame is made with
+        LatencyInfo_synth(&lI, frame_cnt);                      // Headless key presses
+        TRACE_BLOCK("Filtered keys")
         { // Filtered (rapid fire keys)
             SDL_PumpEvents();
             const Uint8 *k = SDL_GetKeyboardState(NULL);        // Get all keys
             if(  k[SDL_SCANCODE_UP]  ) {tv_max++; if(tv_max>255) {tv_max=255;}}
             if(  k[SDL_SCANCODE_DOWN]  ) {tv_max--; if(tv_max<0) {tv_max=0;}}
+            if(  k[SDL_SCANCODE_RIGHT]  ) {tv_density*=1.02; if(tv_density>1) {tv_density=1;}}
+            if(  k[SDL_SCANCODE_LEFT]  ) {tv_density/=1.02; if(tv_density<0.0001) {tv_density=0.0001;}}
         }
+        TRACE_BLOCK("Polled keys")
         { // Polled
             SDL_Event e;
             while(  SDL_PollEvent(&e)  )
             {
                 if(  e.type == SDL_KEYDOWN  )
                 {
+                    bool by_area_was = tv_by_area; bool counter_was = tv_counter;
+                    int dist_was = tv_dist; int cluster_was = tv_cluster; int res_div_was = tv_res_div;
                     switch( e.key.keysym.sym)
                     {
                         case SDLK_ESCAPE: quit = true; break;
+                        case SDLK_a: tv_by_area = !tv_by_area; break;  // Toggle density mode
+                        case SDLK_n: tv_counter = !tv_counter; break;  // Toggle noise generator
+                        case SDLK_d:                            // Next alpha distribution
+                            tv_dist = (tv_dist + 1) % NOISE_DIST_COUNT;
+                            printf("Static: %s\n", noise_dist_name(tv_dist));
+                            break;
+                        case SDLK_g:                            // Toggle grain clumps
+                            tv_cluster = tv_cluster ? 0 : tv_cluster_on;
+                            break;
+                        case SDLK_c:                            // Toggle render path
+                            if(!tv_attached) {tv_composite = !tv_composite;}   // Served static is a plane
+                            break;
+                        case SDLK_t: TRACE_DUMP(); break;       // Dump trace (TRACE builds)
+                        case SDLK_PAGEUP:                       // Finer static
+                            if(tv_res_div>1) {tv_res_div/=2;}
+                            break;
+                        case SDLK_PAGEDOWN:                     // Coarser static
+                            if(tv_res_div<8) {tv_res_div*=2;}
+                            break;
                         default: break;
                     }
+                    bool changed = (tv_by_area != by_area_was) || (tv_counter != counter_was)
+                                || (tv_dist != dist_was) || (tv_cluster != cluster_was)
+                                || (tv_res_div != res_div_was); // Render path : same static
+                    if(  changed  ) LatencyInfo_input(&lI, &e); // Stamp : a later frame shows it
+                }
+            }
+        }
+
+        TRACE_BLOCK("Render size")
+        { // Render size : output pixels (HiDPI aware) scaled down by tv_res_div
+            int out_w, out_h;
+            SDL_GetRendererOutputSize(ren, &out_w, &out_h);     // Real pixels
+            int w = out_w/tv_res_div; if(w<1) {w=1;}
+            int h = out_h/tv_res_div; if(h<1) {h=1;}
+            if(  (w != tv_w) || (h != tv_h)  )                  // Only on change
+            {
+                tv_w = w; tv_h = h;
+                SDL_RenderSetLogicalSize(ren, tv_w, tv_h);      // SDL upscales to output
+                if(  tv_tex  ) SDL_DestroyTexture(tv_tex);
+                tv_tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+                                           SDL_TEXTUREACCESS_STREAMING, tv_w, tv_h);
+                tv_plane = realloc(tv_plane, (size_t)tv_w*tv_h);
+                tv_src_seen = -1;                               // Copy served static again
+            }
+            tv_letterbox = (out_w != tv_w*tv_res_div) || (out_h != tv_h*tv_res_div);
+        }
+
+        // Procedurally generated art
+        TvFrame *tv;                                            // Frame to render
+        TRACE_BLOCK("Share settings")
+        { // Share settings with the generator
+            SDL_AtomicSet(&sh.p.w, tv_w); SDL_AtomicSet(&sh.p.h, tv_h);
+            SDL_AtomicSet(&sh.p.count, (int)(tv_by_area ? tv_density*tv_w*tv_h : tv_count));
+            SDL_AtomicSet(&sh.p.max, tv_max);
+            SDL_AtomicSet(&sh.p.counter, tv_counter);
+            SDL_AtomicSet(&sh.p.dist, tv_dist);
+            SDL_AtomicSet(&sh.p.cluster, tv_cluster);
+            SDL_AtomicSet(&sh.p.seq, LatencyInfo_publish(&lI)); // Last : the rest is this new
+        }
+        if(  !tv_attached && tv_threaded && (tv_thread == NULL)  )
+        { // Start the generator : at launch, or once the static server is gone
+            tv_thread = SDL_CreateThread(tv_generator, "tv-static generator", &sh);
+            if(  tv_thread == NULL  ) tv_threaded = false;      // Fall back to one thread
+        }
+        if(  tv_attached  )
+        TRACE_BLOCK("Copy served TV Static")
+        { // Copy the static under this window from the server
+            tv = &sh.frames[0];                                 // No points, plane only
+            int x, y; SDL_GetWindowPosition(win, &x, &y);       // Screen points, like the plane
+            int seen = NoiseShm_read(&tv_src, tv_src_seen, x, y, wI.w, wI.h,   // Window in points
+                                     tv_plane, tv_w, tv_h);                    // to render pixels
+            Uint32 now = SDL_GetTicks();
+            if(  seen != tv_src_seen  ) tv_src_ticks = now;
+            else if(  now - tv_src_ticks > 1000  )              // Server stopped or restarted
+            {
+                int pid = tv_src.hdr->pid; int frames = SDL_AtomicGet(&tv_src.hdr->frame);
+                NoiseShm_close(&tv_src);
+                tv_attached = NoiseShm_attach(&tv_src);         // False : died, generate from now on
+                if(  tv_attached && (tv_src.hdr->pid == pid)    // Same server, still stuck
+                     && (SDL_AtomicGet(&tv_src.hdr->frame) == frames)  )
+                {
+                    NoiseShm_close(&tv_src); tv_attached = false;
                 }
+                if(  !tv_attached  ) printf("Static server stopped, generating\n");
+                tv_src_ticks = now; seen = -1;
             }
+            tv_src_seen = seen;
+            tv->seq = lI.seq;                                   // Only the render size is ours
+            tv->look = tv_look(tv_w, tv_h, 0, 0, 0, 0, 0);
+        }
+        else if(  tv_threaded  )
+        TRACE_BLOCK("Take the newest TV Static")
+        { // Take the newest TV Static the generator finished
+            TripleBuffer_acquire(&sh.tb);                       // Keep old frame if none
+            tv = &sh.frames[sh.tb.front];
+        }
+        else
+        TRACE_BLOCK("Generate TV Static")
+        { // Generate TV Static
+            tv = &sh.frames[0];
+            tv_generate(&sh, tv);
         }
 
         // Render
+        if(  tv_composite  ) // CPU compositor : one pass, one upload
+        TRACE_BLOCK("Composite")
+        { // Composite Grey Bgnd and TV Static
+            if(  tv_letterbox  )                                // Clear the border only
+            {                                                   // texture doesn't cover
+                SDL_SetRenderDrawColor(ren, 10, 10, 10, 0);
+                SDL_RenderClear(ren);
+            }
+            if(  !tv_attached  ) comp_scatter_points(tv_plane, tv_w, tv_h, tv->noise, tv->alpha, tv->count);
+            Uint32 *px; int pitch;
+            SDL_LockTexture(tv_tex, NULL, (void **)&px, &pitch);   // Write straight to texture
+            comp_frame(px, pitch/4, tv_w, tv_h, comp_argb(10, 10, 10, 255), NULL, 0, 0, tv_plane);
+            SDL_UnlockTexture(tv_tex);
+            SDL_RenderCopy(ren, tv_tex, NULL, NULL);
+        }
+        if(  !tv_composite  ) // SDL : one pass per layer
+        TRACE_BLOCK("Grey Bgnd")
         { // Grey Bgnd
             SDL_SetRenderDrawColor(ren, 10, 10, 10, 0);          // Alpha doesn't matter here
             SDL_RenderClear(ren);
         }
+        if(  !tv_composite  )
+        TRACE_BLOCK("Draw the TV Static")
         { // Draw the TV Static
-            for(int i=0; i<count; i++)
+            for(int i=0; i<tv->count; i++)
             {
-                SDL_SetRenderDrawColor(ren, 255, 255, 255, tv_alpha[i]);
-                SDL_RenderDrawPointF(ren, tv_noise[i].x, tv_noise[i].y);
+                SDL_SetRenderDrawColor(ren, 255, 255, 255, tv->alpha[i]);
+                SDL_RenderDrawPointF(ren, tv->noise[i].x, tv->noise[i].y);
             }
         }
-        { // Free mem for old proc art
-            free(tv_noise);
-            free(tv_alpha);
-        }
+        TRACE_BLOCK("Display to screen")
         { // Display to screen
             SDL_RenderPresent(ren);
+            LatencyInfo_presented(&lI, tv->seq, tv->look);      // Input in this frame is on screen
             SDL_Delay(10);
         }
+        frame_cnt++;
+        if(  frame_limit && (frame_cnt >= frame_limit)  ) quit = true; // Headless run is done
     }
 
     // Shutdown
+    SDL_AtomicSet(&sh.p.quit, 1);
+    if(  tv_thread  ) SDL_WaitThread(tv_thread, NULL);         // Generator is done
+    for(int i=0; i<3; i++) { free(sh.frames[i].noise); free(sh.frames[i].alpha); }
+    if(  tv_attached  ) NoiseShm_close(&tv_src);
+    bool latency_ok = LatencyInfo_report(&lI);
+    TRACE_DUMP();
+    free(tv_plane);
     shutdown();
-    return EXIT_SUCCESS;
+    return latency_ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 